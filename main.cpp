@@ -8,6 +8,8 @@
 #include <iostream> // for cin, cout, endl
 #include <cmath> // for sin
 #include <string> // for string, to_string
+#include <cstdlib> // for rand
+#include <vector> // for vector
 
 // our headers
 #include "src/shader.h" // defines the Shader class
@@ -21,6 +23,18 @@
 #include "src/collision.h" // defines some collision functions
 #include "src/thing.h" // defines the Thing class
 #include "src/octree.h" // defines the Octree class
+#include "src/physics.h" // defines the PhysicsWorld class
+#include "src/physicsstats.h" // defines the PhysicsStats class
+#include "src/particles.h" // defines the ParticleSystem class
+#include "src/uniformbuffers.h" // defines the UniformBuffer class
+#include "src/lightclusters.h" // defines the LightClusters class
+#include "src/programcache.h" // defines the program binary cache
+#include "src/geometryarena.h" // defines the GeometryArena class
+#include "src/frustum.h" // defines the FrustumCuller class
+#include "src/occlusion.h" // defines the OcclusionBuffer class
+#include "src/portals.h" // defines the CellGraph class
+#include "src/renderqueue.h" // defines the RenderQueue class
+#include "src/scenegen.h" // defines the scene generator
 
 // declaring some global variables before main
 Camera camera(glm::vec3(-2.0, 1.0, -2.0), glm::vec3(0.0f, 1.0f, 0.0f), 45.0f);
@@ -41,8 +55,14 @@ bool firstMouse = true;
 bool stayXZ = true;
 bool flashLightOn = false;
 bool cursorLocked = true;
-
-int main()
+bool throwSparks = false;
+const unsigned int SPARK_BURST = 200;
+bool dropBalls = false;
+const unsigned int BALL_BURST = 20;
+const unsigned int MAX_BALLS = 1000;
+bool printCulling = false;
+
+int main(int argc, char **argv)
 {
   // getting everything initialized
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -76,24 +96,77 @@ int main()
     return -1;
   }
 
+  // linked shaders get cached on disk, if the driver can hand them back
+  if (!initProgramCache((GLADloadproc)glfwGetProcAddress))
+    std::cout << "Program binaries aren't supported, shaders will compile from source" << std::endl;
+  if (!initMultiDraw((GLADloadproc)glfwGetProcAddress))
+    std::cout << "Multi-draw isn't supported, the level will take a draw call per mesh" << std::endl;
+
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
   // getting and building shaders, models, etc. from other files
   ///////////////////////////////////////////////////////////////////////////////////////
 	// shaders
-  Shader objectShader("shaders/object.vert", "shaders/object.frag");
+  ShaderVariants objectShaders("shaders/object.vert", "shaders/object.frag");
   Shader lightShader("shaders/light.vert", "shaders/light.frag");
 	Shader textShader("shaders/text.vert", "shaders/text.frag");
+	Shader particleShader("shaders/particle.vert", "shaders/particle.frag");
   
-	// the model
-	std::string filepath = "resources/box-scene/box-scene.obj";
-	Model ourModel(filepath.c_str());
+	// the model, which can be swapped for another level (like one from scenegen). It never
+	// moves, so its meshes get batched by material (within each patch of the level, so they
+	// can still be culled), and it only keeps its positions on the cpu, for collision.
+	std::string filepath = (argc > 1) ? argv[1] : "resources/box-scene/box-scene.obj";
+	GeometryArena arena;
+	Model ourModel(filepath.c_str(), KEEP_POSITIONS, true, &arena);
+
+	// the physics world, which collides things with the model
+	PhysicsWorld world;
+	world.SetStaticGeometry(ourModel.ToTriangles());
+
+	// the sphere thing, and the balls dropped with b, which all share one model so they can
+	// be drawn instanced. It's packed, so there's half as much vertex data to read per ball.
+	Model sphereModel("resources/boxsphere/boxsphere.obj", THING_RESIDENCY, BATCH_MESHES, NULL, PACKED_VERTICES);
+	Thing sphere(world, glm::vec3(0.0f, 10.0f, -5.0f), glm::vec3(0.0f), glm::vec3(1.0f, 2.5f, 1.0f), glm::vec3(0.4f, 1.0f, 0.4f), sphereModel, "testsphere");
+	std::vector<Thing> balls;
+	balls.reserve(MAX_BALLS);
+
+	// levels written by scenegen come with a .spawns file of bodies to drop in, which become
+	// balls (the ball model's radius is 0.4 per unit of scale)
+	std::vector<Ellipsoid> spawns;
+	std::string spawnsPath = filepath + ".spawns";
+	if (readSceneSpawns(spawnsPath.c_str(), spawns))
+	{
+		for (unsigned int i = 0; i < spawns.size() && balls.size() < MAX_BALLS; ++i)
+			balls.emplace_back(world, spawns[i].Position, spawns[i].Velocity, spawns[i].Radii * 2.5f, spawns[i].Radii, sphereModel, "spawn");
+		std::cout << "Spawned " << balls.size() << " of the level's " << spawns.size() << " bodies" << std::endl;
+	}
+	ThingRenderer thingRenderer;
+	FrustumCuller culler;
+	RenderQueue renderQueue;
+
+	// the level's walls hide whatever's behind them
+	OcclusionBuffer occlusion;
+	culler.SetOcclusion(&occlusion);
+	std::cout << ourModel.DesignateOccluders() << " of the level's meshes are occluders" << std::endl;
+
+	// indoor levels can split themselves into cells joined by portals, in a .cells file next
+	// to the level. only what's in a cell the camera can see through them is drawn, and
+	// things in the other cells are only simulated every few ticks.
+	CellGraph cells;
+	std::string cellsPath = filepath.substr(0, filepath.find_last_of('.')) + ".cells";
+	if (cells.Load(cellsPath.c_str()))
+	{
+		culler.SetCells(&cells);
+		std::cout << "Loaded " << cells.NumCells() << " cells and " << cells.NumPortals() << " portals" << std::endl;
+	}
 
-	std::vector<Triangle> tris = ourModel.ToTriangles();
+	std::cout << "Level drawn in " << ourModel.NumMeshes() << " batches" << std::endl;
+	std::cout << "Freed " << (ourModel.ReclaimedBytes() + sphereModel.ReclaimedBytes()) / 1024 << " KB of vertex data after upload" << std::endl;
+	std::cout << "Level takes " << ourModel.GpuBytes() / 1024 << " KB on the gpu, the sphere (packed) " << sphereModel.GpuBytes() / 1024 << " KB" << std::endl;
 
-	// the sphere thing
-	Thing sphere(glm::vec3(0.0f, 10.0f, -5.0f), glm::vec3(0.0f), glm::vec3(1.0f, 2.5f, 1.0f), glm::vec3(0.4f, 1.0f, 0.4f), "resources/boxsphere/boxsphere.obj", "testsphere");
+	// the sparks
+	ParticleSystem sparks;
 
 	// the text
 	Text sampleText("hello there, world!", SCR_WIDTH, SCR_HEIGHT, 30, 30, 400, 20, 5);
@@ -105,20 +178,52 @@ int main()
   // getting lighting stuff set up
   glm::vec3 lightColor = glm::vec3(1.0f);
 
-	PointLight ptLights[] = {
-    PointLight(glm::vec3(0.0f, 1.0f, 2.0f), lightColor * 0.0f, lightColor * 0.5f, lightColor)
+	// point lights and spotlights are clustered, so there can be as many of them as we like
+	std::vector<PointLight> ptLights = {
+    PointLight(glm::vec3(0.0f, 1.0f, 2.0f), lightColor * 0.0f, lightColor * 0.5f, lightColor, CONSTANT, LINEAR, QUADRATIC, false)
 	};
 
 	DirectionalLight dirLights[] = {
     DirectionalLight(glm::vec3(-1.0f, -1.0f, 0.3f), lightColor * 0.5f, lightColor * 0.0f, lightColor * 0.0f)
 	};
 
-	SpotLight spotLights[] = {
+	std::vector<SpotLight> spotLights = {
 		SpotLight(glm::vec3(0.0f), glm::vec3(0.0f), glm::cos(glm::radians(15.0f)), glm::cos(glm::radians(20.0f)), lightColor * 0.0f, lightColor * 0.8f, lightColor * 1.0f, 1.0f, 0.09f, 0.032f),
 		SpotLight(glm::vec3(1.0f), glm::vec3(1.0f), glm::cos(glm::radians(180.0f)), glm::cos(glm::radians(180.0f)), glm::vec3(0.0f), glm::vec3(0.5f), glm::vec3(1.0f), 1.0f, 0.09f, 0.032f),
-    SpotLight(glm::vec3(5.2f, -6.0f, -3.0f), glm::vec3(-0.2f, 0.0f, 1.0f), glm::cos(glm::radians(18.0f)), glm::cos(glm::radians(25.0f)), lightColor * 0.0f, lightColor * 0.5f, lightColor * 1.0f)
+    SpotLight(glm::vec3(5.2f, -6.0f, -3.0f), glm::vec3(-0.2f, 0.0f, 1.0f), glm::cos(glm::radians(18.0f)), glm::cos(glm::radians(25.0f)), lightColor * 0.0f, lightColor * 0.5f, lightColor * 1.0f, CONSTANT, LINEAR, QUADRATIC, false)
 	};
 
+  // the uniform buffers every shader reads the camera, lights and material from
+  UniformBuffer<CameraData> cameraBuffer(CAMERA_BINDING);
+  UniformBuffer<LightsData> lightsBuffer(LIGHTS_BINDING);
+  UniformBuffer<MaterialData> materialBuffer(MATERIAL_BINDING);
+  MaterialData material = {};
+  material.Shininess = 31.0f;
+  materialBuffer.Set(material);
+
+  // the object shader is specialized for what's actually in the scene: how many directional
+  // lights there are, no emission, and whether each model has specular maps
+  ShaderDefines sceneDefines;
+  sceneDefines["NUM_DIR_LIGHTS"] = std::to_string(sizeof(dirLights) / sizeof(dirLights[0]));
+  sceneDefines["DO_EMISSION"] = "0";
+
+  // the level lives in the arena, so it's drawn from there
+  ShaderDefines levelDefines = sceneDefines;
+  levelDefines["HAS_SPECULAR_MAP"] = ourModel.HasSpecularMaps() ? "1" : "0";
+  levelDefines["ARENA_DRAW"] = "1";
+  Shader &levelShader = objectShaders.Get(levelDefines);
+
+  // things are drawn instanced, by the thing renderer
+  ShaderDefines sphereDefines = sceneDefines;
+  sphereDefines["HAS_SPECULAR_MAP"] = sphereModel.HasSpecularMaps() ? "1" : "0";
+  sphereDefines["INSTANCED"] = "1";
+  sphereDefines["PACKED_VERTICES"] = "1";
+  Shader &sphereShader = objectShaders.Get(sphereDefines);
+
+  LightClusters lightClusters;
+  lightClusters.SetSamplers(levelShader);
+  lightClusters.SetSamplers(sphereShader);
+
   // also enabling depth test to make sure that stuff in the front is drawn
   glEnable(GL_DEPTH_TEST);
 
@@ -134,8 +239,6 @@ int main()
 		// getting continuous inputs
 		processInput(window);
 
-		objectShader.use();
-
     // move stuff like lights as needed
     ptLights[0].Position.x = 2.0f * std::cos(glfwGetTime() / 2.0f);
     ptLights[0].Position.z = 2.0f * std::sin(glfwGetTime() / 2.0f);
@@ -144,41 +247,60 @@ int main()
 		if (spotLights[0].IsOn != flashLightOn)
 			spotLights[0].IsOn = flashLightOn;
 
-		// configuring uniforms
-		//ptLights[0].AddLight(objectShader, 0, "ptlight");
-    dirLights[0].AddLight(objectShader, 0, "dirlight");
-		spotLights[0].AddLight(objectShader, 0, "spotlight");
-		spotLights[1].AddLight(objectShader, 1, "spotlight");
-    objectShader.setVec3("material.specular", glm::vec3(0.1f));
-    objectShader.setFloat("material.shininess", 31.0f);
-		objectShader.setVec3("viewPos", camera.CameraPosition);
-    objectShader.setFloat("time", glfwGetTime() / 3);
-    objectShader.setBool("doEmission", false);
+		// updating the uniform buffers, which only upload what's changed
+		LightsData lights = {};
+		lights.DirLights[0] = dirLights[0].ToData();
+		lightsBuffer.Set(lights);
+
+		int frameWidth, frameHeight;
+		glfwGetFramebufferSize(window, &frameWidth, &frameHeight);
+
+		CameraData cameraData;
+		cameraData.View = camera.GetViewMatrix();
+		cameraData.Projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+		cameraData.ViewPos = camera.CameraPosition;
+		cameraData.Time = glfwGetTime() / 3;
+		cameraData.ScreenSize = glm::vec2(frameWidth, frameHeight);
+		cameraData.NearPlane = NEAR_PLANE;
+		cameraData.FarPlane = FAR_PLANE;
+		cameraBuffer.Set(cameraData);
+
+		cameraBuffer.Upload();
+		lightsBuffer.Upload();
+		materialBuffer.Upload();
+
+		// sorting the point lights and spotlights into clusters
+		lightClusters.SetProjection(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+		lightClusters.Build(cameraData.View, ptLights, spotLights);
+		lightClusters.Upload();
+		lightClusters.Bind();
 
     // remaking matrices
     glm::mat4 modelObject = glm::mat4(1.0f);
     modelObject = glm::translate(modelObject, glm::vec3(0.0f));
 
-    glm::mat4 view = camera.GetViewMatrix();
-
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f); 
-
-		objectShader.use();
-		objectShader.setMat4("model", modelObject);
-		objectShader.setMat4("view", view);
-		objectShader.setMat4("projection", projection);
-
     // background
     glClearColor(0.2f, 0.5f, 0.8f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// drawing environment
-		ourModel.Draw(objectShader);
+		// only drawing what's in view, in a cell that can be seen and not behind the level's walls
+		glm::mat4 viewProjection = cameraData.Projection * cameraData.View;
+		occlusion.Begin(viewProjection);
+		ourModel.AddOccluders(occlusion, modelObject);
+		occlusion.Finish();
+		culler.SetFrustum(viewProjection);
+		if (!cells.Empty())
+			cells.FindVisible(camera.CameraPosition, viewProjection);
+
+		// drawing environment, all at once from the arena
+		ourModel.Queue(modelObject, culler);
+		arena.Submit(levelShader);
 
 		// drawing sphere
-		if (glm::length(sphere.Position - camera.CameraPosition) <= 1.2f)
+		Ellipsoid &sphereBody = sphere.Body();
+		if (glm::length(sphereBody.Position - camera.CameraPosition) <= 1.2f)
 		{
-			sphere.Velocity += glm::normalize(sphere.Position - camera.CameraPosition) * 0.005f;
+			sphereBody.Velocity += glm::normalize(sphereBody.Position - camera.CameraPosition) * 0.005f;
 		}
 		/*
 		handleIntersection(sphere, tris, sphere.Position, sphere.Velocity);
@@ -191,8 +313,54 @@ int main()
 
 		sphereModel.Draw(objectShader);
 		*/
-		sphere.PassFrame(tris);
-		sphere.RenderThing(camera, objectShader, SCR_WIDTH, SCR_HEIGHT);
+		if (dropBalls)
+		{
+			for (unsigned int i = 0; i < BALL_BURST && balls.size() < MAX_BALLS; ++i)
+			{
+				glm::vec3 spread(std::rand() / (float)RAND_MAX - 0.5f, 0.0f, std::rand() / (float)RAND_MAX - 0.5f);
+				balls.emplace_back(world, camera.CameraPosition + camera.CameraDirection * 2.0f + spread * 2.0f, glm::vec3(0.0f), glm::vec3(0.25f), glm::vec3(0.1f), sphereModel, "ball");
+			}
+			dropBalls = false;
+		}
+
+		if (!cells.Empty())
+		{
+			world.SetBodyActive(sphere.BodyID, cells.PointVisible(sphere.Body().Position));
+			for (unsigned int i = 0; i < balls.size(); ++i)
+				world.SetBodyActive(balls[i].BodyID, cells.PointVisible(balls[i].Body().Position));
+		}
+
+		world.Step(deltaTime);
+
+		// drawing things, with one instanced draw per model, sorted to change as little
+		// state as possible
+		thingRenderer.Add(sphere);
+		for (unsigned int i = 0; i < balls.size(); ++i)
+			thingRenderer.Add(balls[i]);
+		thingRenderer.Draw(sphereShader, &culler, &renderQueue);
+		renderQueue.Submit();
+
+		if (printCulling)
+		{
+			std::cout << "Drew " << culler.NumDrawn() << ", culled " << culler.NumCulled() << ", occluded " << culler.NumOccluded() << ", unreachable " << culler.NumUnreachable() << " (meshes and things)" << std::endl;
+			if (!cells.Empty())
+				std::cout << cells.NumVisibleCells() << " of " << cells.NumCells() << " cells visible, " << world.NumActiveBodies() << " of " << world.NumBodies() << " bodies simulated every tick" << std::endl;
+			std::cout << "Queue drew " << renderQueue.NumSubmitted() << " draws with " << renderQueue.NumStateChanges() << " state changes, " << renderQueue.NumStateChangesFiltered() << " redundant ones skipped" << std::endl;
+			printCulling = false;
+		}
+
+		// throwing and drawing sparks
+		if (throwSparks)
+		{
+			for (unsigned int i = 0; i < SPARK_BURST; ++i)
+			{
+				glm::vec3 spread(std::rand() / (float)RAND_MAX - 0.5f, std::rand() / (float)RAND_MAX - 0.5f, std::rand() / (float)RAND_MAX - 0.5f);
+				sparks.Emit(camera.CameraPosition + camera.CameraDirection, camera.CameraDirection * 4.0f + spread * 3.0f, 3.0f, 0.01f);
+			}
+			throwSparks = false;
+		}
+		sparks.Update(deltaTime, &world);
+		sparks.Draw(particleShader);
 
 		// drawing text
 		sampleText.DrawText(textShader);
@@ -225,6 +393,10 @@ void processInput(GLFWwindow *window)
 // f - activate wireframe mode
 // n - activate/deactivate noclip
 // t - activate/deactivate flashlight
+// p - throw some sparks
+// b - drop some balls
+// f8 - print how much frustum and occlusion culling skipped this frame
+// f9 - dump physics stats to a csv
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
   if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)  
@@ -237,10 +409,23 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     stayXZ = !stayXZ;
 	if (key == GLFW_KEY_T && action == GLFW_PRESS)
 		flashLightOn = !flashLightOn;
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+		throwSparks = true;
+	if (key == GLFW_KEY_B && action == GLFW_PRESS)
+		dropBalls = true;
 	if (key == GLFW_KEY_F11 && action == GLFW_PRESS) {
 		std::string filename = "screenshots/scrshot_" + std::to_string(time(NULL)) + ".png";
 		saveScreenshot(filename.c_str());
 	}
+	if (key == GLFW_KEY_F8 && action == GLFW_PRESS)
+		printCulling = true;
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS) {
+		std::string filename = "physics_" + std::to_string(time(NULL)) + ".csv";
+		if (physicsStats.WriteCSV(filename.c_str()))
+			std::cout << "Wrote physics stats to " << filename << std::endl;
+		else
+			std::cout << "Failed to write physics stats to " << filename << std::endl;
+	}
 	if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
 	{
 		if (cursorLocked)
@@ -0,0 +1,81 @@
+// occlusioncheck.cpp
+// Command line check for the occlusion buffer. Rasterizes a wall into one, with no window
+// or gl, and checks which boxes it says are hidden behind it. Exits with 1 if any are
+// wrong.
+//
+// usage:
+//   ./occlusioncheck
+
+// libraries
+#include <glm/glm.hpp> // gl mathematics
+#include <glm/gtc/matrix_transform.hpp>
+
+// stdlib
+#include <iostream> // for cout, endl
+
+// our headers
+#include "src/occlusion.h" // defines the OcclusionBuffer class
+
+// the camera's at the origin looking down -z, like an identity view matrix
+const float CHECK_FOV = 45.0f;
+const float CHECK_NEAR = 0.1f;
+const float CHECK_FAR = 100.0f;
+
+// the wall is a quad across the bottom half of the view, from its left edge to just past
+// the middle, 5 units away. Its right edge lands 0.7 of the way across a pixel, so the
+// pixel's centre is covered but not all of it.
+const float WALL_Z = -5.0f;
+const float WALL_RIGHT = 0.022652f;
+
+// A box, and whether it should be visible
+struct BoxCheck {
+	const char *Name;
+	glm::vec3 Min, Max;
+	bool Visible;
+};
+
+// checks one box, printing how it went. Returns whether it was right.
+bool checkBox(OcclusionBuffer &buffer, const BoxCheck &check)
+{
+	bool visible = buffer.BoxVisible(check.Min, check.Max);
+	bool right = (visible == check.Visible);
+	std::cout << (right ? "ok    " : "FAILED") << " " << check.Name << ": " << (visible ? "visible" : "hidden") << std::endl;
+	return right;
+}
+
+int main()
+{
+	OcclusionBuffer buffer;
+	glm::mat4 projection = glm::perspective(glm::radians(CHECK_FOV), (float)buffer.Width() / buffer.Height(), CHECK_NEAR, CHECK_FAR);
+
+	buffer.Begin(projection);
+	glm::vec3 wall[4] = {
+		glm::vec3(-10.0f, -10.0f, WALL_Z),
+		glm::vec3(WALL_RIGHT, -10.0f, WALL_Z),
+		glm::vec3(WALL_RIGHT, 0.0f, WALL_Z),
+		glm::vec3(-10.0f, 0.0f, WALL_Z)
+	};
+	buffer.AddTriangle(wall[0], wall[1], wall[2]);
+	buffer.AddTriangle(wall[0], wall[2], wall[3]);
+	buffer.Finish();
+
+	BoxCheck checks[] = {
+		{"behind the wall", glm::vec3(-1.0f, -3.0f, -11.0f), glm::vec3(-0.5f, -1.0f, -9.0f), false},
+		{"small and just behind the wall", glm::vec3(-0.2f, -2.0f, -6.0f), glm::vec3(-0.1f, -1.9f, -5.9f), false},
+		{"in front of the wall", glm::vec3(-1.0f, -3.0f, -4.0f), glm::vec3(-0.5f, -1.0f, -3.0f), true},
+		{"peeking over the wall", glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(-0.5f, 1.0f, -9.0f), true},
+		{"past the wall's side", glm::vec3(1.0f, -3.0f, -11.0f), glm::vec3(2.0f, -1.0f, -9.0f), true},
+		{"past the wall's side, in its edge pixel", glm::vec3(0.051777f, -1.1f, -10.0f), glm::vec3(0.061484f, -1.05f, -10.0f), true},
+		{"through the near plane", glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), true}
+	};
+
+	unsigned int failed = 0;
+	for (unsigned int i = 0; i < sizeof(checks) / sizeof(checks[0]); ++i)
+	{
+		if (!checkBox(buffer, checks[i]))
+			++failed;
+	}
+
+	std::cout << buffer.NumOccluderTriangles() << " occluder triangles, " << buffer.NumOccluded() << " of " << buffer.NumTested() << " boxes hidden, " << failed << " wrong" << std::endl;
+	return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// scenegen.cpp
+// Command line tool for the scene generator. Either writes a generated level out for the
+// renderer, or drops its bodies into a PhysicsWorld and times how long it takes to step.
+//
+// usage:
+//   ./scenegen write <type> <triangles> <seed> <file.obj>
+//   ./scenegen bench <type> <triangles> <seed> [bodies] [ticks]
+// where type is one of stairs, heightfield, soup or crates
+
+// libraries
+#include <glm/glm.hpp> // gl mathematics
+
+// stdlib
+#include <iostream> // for cout, endl
+#include <string> // for string, stoul
+#include <chrono> // for steady_clock
+#include <stdexcept> // for exception
+#include <climits> // for UINT_MAX
+
+// our headers
+#include "src/shapes.h" // defines Shape classes
+#include "src/physics.h" // defines the PhysicsWorld class
+#include "src/physicsstats.h" // defines the PhysicsStats class
+#include "src/scenegen.h" // defines the scene generator
+
+const unsigned int BENCH_TICKS = 600;
+
+// prints how to use the tool
+int usage()
+{
+	std::cout << "usage:" << std::endl;
+	std::cout << "  scenegen write <type> <triangles> <seed> <file.obj>" << std::endl;
+	std::cout << "  scenegen bench <type> <triangles> <seed> [bodies] [ticks]" << std::endl;
+	std::cout << "types: stairs, heightfield, soup, crates" << std::endl;
+	return 1;
+}
+
+// reads a whole, non-negative number. Returns whether the text was one.
+bool parseCount(const char *text, unsigned int &value)
+{
+	if (text[0] == '-')
+		return false;
+	try
+	{
+		size_t used;
+		unsigned long number = std::stoul(text, &used);
+		if (text[used] != '\0' || number > UINT_MAX)
+			return false;
+		value = (unsigned int)number;
+		return true;
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+// The smallest, largest and total of something measured every tick
+struct TickSummary {
+	double Min, Max, Total;
+	unsigned int Count;
+
+	TickSummary() : Min(0.0), Max(0.0), Total(0.0), Count(0) {}
+
+	void Add(double value)
+	{
+		Min = (Count == 0 || value < Min) ? value : Min;
+		Max = (Count == 0 || value > Max) ? value : Max;
+		Total += value;
+		++Count;
+	}
+
+	double Average() const
+	{
+		return (Count > 0) ? Total / Count : 0.0;
+	}
+};
+
+// prints a summary as one "min / avg / max" line
+void printSummary(const char *name, const TickSummary &summary)
+{
+	std::cout << "  " << name << ": " << summary.Min << " / " << summary.Average() << " / " << summary.Max << std::endl;
+}
+
+// milliseconds since the given time
+double msSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 5)
+		return usage();
+
+	std::string mode = argv[1];
+	SceneType type;
+	if (!parseSceneType(argv[2], type))
+		return usage();
+	unsigned int numTris, seed;
+	if (!parseCount(argv[3], numTris) || !parseCount(argv[4], seed))
+		return usage();
+
+	if (mode == "write")
+	{
+		if (argc < 6)
+			return usage();
+
+		GeneratedScene scene = generateScene(type, numTris, seed);
+		std::string spawnPath = std::string(argv[5]) + ".spawns";
+		if (!writeSceneOBJ(scene, argv[5]) || !writeSceneSpawns(scene, spawnPath.c_str()))
+			return 1;
+
+		std::cout << "wrote " << scene.Tris.size() << " triangles to " << argv[5] << " and " << scene.Spawns.size() << " spawns to " << spawnPath << std::endl;
+		return 0;
+	}
+
+	if (mode == "bench")
+	{
+		unsigned int numBodies = SCENE_BODIES;
+		unsigned int ticks = BENCH_TICKS;
+		if ((argc > 5 && !parseCount(argv[5], numBodies)) || (argc > 6 && !parseCount(argv[6], ticks)) || ticks == 0)
+			return usage();
+
+		auto start = std::chrono::steady_clock::now();
+		GeneratedScene scene = generateScene(type, numTris, seed, numBodies);
+		double generateMs = msSince(start);
+
+		PhysicsWorld world;
+		start = std::chrono::steady_clock::now();
+		world.SetStaticGeometry(scene.Tris);
+		double buildMs = msSince(start);
+
+		for (unsigned int i = 0; i < scene.Spawns.size(); ++i)
+			world.AddBody(scene.Spawns[i]);
+
+		// stepping exactly one tick at a time, so every run does the same work. each tick's
+		// time (and counters) go into a summary, since one tick can be far from typical.
+		TickSummary tickMs;
+#ifdef PHYSICS_STATS
+		TickSummary queries, candidates, planeRejects, quadraticTests, passCapHits;
+#endif
+		double stepMs = 0.0;
+		for (unsigned int i = 0; i < ticks; ++i)
+		{
+			start = std::chrono::steady_clock::now();
+			world.Step(world.TickLength);
+			double ms = msSince(start);
+			stepMs += ms;
+			tickMs.Add(ms);
+
+#ifdef PHYSICS_STATS
+			const PhysicsFrameStats &last = physicsStats.Last();
+			queries.Add(last.Queries);
+			candidates.Add(last.Candidates);
+			planeRejects.Add(last.PlaneRejects);
+			quadraticTests.Add(last.QuadraticTests);
+			passCapHits.Add(last.PassCapHits);
+#endif
+		}
+
+		std::cout << sceneTypeName(type) << ": " << scene.Tris.size() << " triangles, " << scene.Spawns.size() << " bodies, " << ticks << " ticks" << std::endl;
+		std::cout << "generate " << generateMs << " ms, build " << buildMs << " ms, step " << stepMs << " ms" << std::endl;
+		std::cout << "static index " << world.StaticMemoryUsage() << " bytes (" << world.StaticBytesPerTriangle() << " per triangle)" << std::endl;
+
+		std::cout << "per tick, min / avg / max:" << std::endl;
+		printSummary("ms", tickMs);
+#ifdef PHYSICS_STATS
+		printSummary("queries", queries);
+		printSummary("candidates", candidates);
+		printSummary("plane rejects", planeRejects);
+		printSummary("quadratic tests", quadraticTests);
+		printSummary("pass cap hits", passCapHits);
+#endif
+		return 0;
+	}
+
+	return usage();
+}
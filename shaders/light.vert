@@ -2,8 +2,16 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform Camera {
+  mat4 view;
+  mat4 projection;
+  vec3 viewPos;
+  float time;
+  vec2 screenSize;
+  float nearPlane;
+  float farPlane;
+};
 
 void main()
 {
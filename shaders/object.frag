@@ -5,72 +5,101 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform float time;
-uniform bool doEmission;
+layout (std140) uniform Camera {
+  mat4 view;
+  mat4 projection;
+  vec3 viewPos;
+  float time;
+  vec2 screenSize;
+  float nearPlane;
+  float farPlane;
+};
+
+layout (std140) uniform MaterialBlock {
+  float shininess;
+};
+
+// the variant defines, which ShaderVariants compiles a copy of this shader for each set of.
+// These are the defaults for when it's compiled without them.
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 20
+#endif
+#ifndef DO_EMISSION
+#define DO_EMISSION 0
+#endif
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 1
+#endif
 
 struct Material {
   sampler2D texture_diffuse0;
   sampler2D texture_specular0;
-  float shininess;
   sampler2D emission;
 };
 
 struct PointLight {
   vec3 position;
-
   float constant;
-  float linear;
-  float quadratic;
-
   vec3 ambient;
+  float linear;
   vec3 diffuse;
+  float quadratic;
   vec3 specular;
-
   bool isOn;
 };
 
+// laid out the same way as DirectionalLightData in light.h
 struct DirLight {
   vec3 direction;
-  
+  bool isOn;
   vec3 ambient;
   vec3 diffuse;
   vec3 specular;
-
-	bool isOn;
 };
 
 struct SpotLight {
   vec3 position;
-  vec3 direction;
-
   float cutOff;
+  vec3 direction;
   float outerCutOff;
-
   vec3 ambient;
+  float constant;
   vec3 diffuse;
+  float linear;
   vec3 specular;
-
-	float constant;
-	float linear;
-	float quadratic;
-
-	bool isOn;
+  float quadratic;
+  bool isOn;
 };
 
-#define NUM_POINT_LIGHTS 20
-#define NUM_DIR_LIGHTS 20
-#define NUM_SPOT_LIGHTS 20
+// the light cluster grid, which has to match lightclusters.h
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
 
 uniform Material material;
-uniform PointLight ptlight[NUM_POINT_LIGHTS];
-uniform DirLight dirlight[NUM_DIR_LIGHTS];
-uniform SpotLight spotlight[NUM_SPOT_LIGHTS];
+
+// the block can be declared shorter than LightsData, which just leaves the rest unread
+#if NUM_DIR_LIGHTS > 0
+layout (std140) uniform Lights {
+  DirLight dirlight[NUM_DIR_LIGHTS];
+};
+#endif
+
+// point lights and spotlights come from the light clusters instead: the lights themselves
+// (as their std140 structs, four floats at a time), each cluster's range of lights, and the
+// list of light indices those ranges point into
+uniform samplerBuffer clusterPointLights;
+uniform samplerBuffer clusterSpotLights;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
 
 // defining some functions beforehand so that main can go first
 vec3 processPointLight(PointLight, vec3, vec3, vec3);
 vec3 processDirLight(DirLight, vec3, vec3, vec3);
 vec3 processSpotLight(SpotLight, vec3, vec3, vec3);
+PointLight fetchPointLight(int);
+SpotLight fetchSpotLight(int);
+vec3 specularMap();
 
 void main()
 {
@@ -78,34 +107,44 @@ void main()
   vec3 norm = normalize(Normal);
   vec3 viewDir = normalize(viewPos - FragPos);
 
+  // finding which cluster we're in, from where we are on screen and how deep we are
+  float depth = max(-(view * vec4(FragPos, 1.0)).z, nearPlane);
+  int slice = int(log(depth / nearPlane) / log(farPlane / nearPlane) * float(CLUSTERS_Z));
+  ivec3 cell = ivec3(gl_FragCoord.xy / screenSize * vec2(CLUSTERS_X, CLUSTERS_Y), slice);
+  cell = clamp(cell, ivec3(0), ivec3(CLUSTERS_X - 1, CLUSTERS_Y - 1, CLUSTERS_Z - 1));
+  uvec4 cluster = texelFetch(clusterRanges, cell.x + CLUSTERS_X * (cell.y + CLUSTERS_Y * cell.z));
+
   // getting point light component
   vec3 ptLightComp = vec3(0.0);
-  for (int i = 0; i < NUM_POINT_LIGHTS; ++i) {
-    ptLightComp += processPointLight(ptlight[i], norm, FragPos, viewDir);
+  for (uint i = 0u; i < cluster.y; ++i) {
+    int light = int(texelFetch(clusterLightIndices, int(cluster.x + i)).r);
+    ptLightComp += processPointLight(fetchPointLight(light), norm, FragPos, viewDir);
   }
 
   // getting directional light compoment
 	vec3 dirLightComp = vec3(0.0);
+#if NUM_DIR_LIGHTS > 0
 	for (int i = 0; i < NUM_DIR_LIGHTS; ++i) {
 		dirLightComp += processDirLight(dirlight[i], norm, FragPos, viewDir);
 	}
+#endif
 
   // getting spotlight component
 	vec3 spotLightComp = vec3(0.0);
-	for (int i = 0; i < NUM_SPOT_LIGHTS; ++i) {
-		spotLightComp += processSpotLight(spotlight[i], norm, FragPos, viewDir);
+	for (uint i = 0u; i < cluster.w; ++i) {
+		int light = int(texelFetch(clusterLightIndices, int(cluster.z + i)).r);
+		spotLightComp += processSpotLight(fetchSpotLight(light), norm, FragPos, viewDir);
 	}
 
   // adding emission maps as needed
   vec3 emission = vec3(0.0);
-  if (doEmission)
+#if DO_EMISSION
+  if (specularMap().r == 0.0)
   {
-    if (texture(material.texture_specular0, TexCoords).r == 0.0)
-    {
-      float emissionBrightness = texture(material.emission, vec2(TexCoords.x, TexCoords.y + time)).g;
-      emission = vec3(0.5, 0.1, 1.0) * emissionBrightness;
-    }
+    float emissionBrightness = texture(material.emission, vec2(TexCoords.x, TexCoords.y + time)).g;
+    emission = vec3(0.5, 0.1, 1.0) * emissionBrightness;
   }
+#endif
 
   // combining all of the vectors into one result vector
   vec3 result = ptLightComp + dirLightComp + spotLightComp + emission;
@@ -126,8 +165,8 @@ vec3 processPointLight(PointLight ptlight, vec3 norm, vec3 fragPos, vec3 viewDir
 
     // getting specular lighting ready
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = ptlight.specular * spec * vec3(texture(material.texture_specular0, TexCoords));
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = ptlight.specular * spec * specularMap();
 
     // getting attenuation ready
     float distance = length(ptlight.position - fragPos);
@@ -157,8 +196,8 @@ vec3 processDirLight(DirLight dirlight, vec3 norm, vec3 fragPos, vec3 viewDir)
 
     // getting specular lighting ready
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = dirlight.specular * spec * vec3(texture(material.texture_specular0, TexCoords));
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = dirlight.specular * spec * specularMap();
 
     // combining all of the vectors into one result vector
     vec3 result = ambient + diffuse + specular;
@@ -196,8 +235,8 @@ vec3 processSpotLight(SpotLight spotlight, vec3 norm, vec3 fragPos, vec3 viewDir
 
       // getting specular lighting ready
       vec3 reflectDir = reflect(-lightDir, norm);
-      float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-      specular = intensity * spotlight.specular * spec * vec3(texture(material.texture_specular0, TexCoords));
+      float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+      specular = intensity * spotlight.specular * spec * specularMap();
 
       // getting attenuation ready
 			float distance = length(spotlight.position - fragPos);
@@ -213,3 +252,34 @@ vec3 processSpotLight(SpotLight spotlight, vec3 norm, vec3 fragPos, vec3 viewDir
 		return vec3(0.0);
 	}
 }
+
+// reads a point light out of its cluster buffer. Only lights that are on get clustered.
+PointLight fetchPointLight(int index)
+{
+  vec4 a = texelFetch(clusterPointLights, index * 4);
+  vec4 b = texelFetch(clusterPointLights, index * 4 + 1);
+  vec4 c = texelFetch(clusterPointLights, index * 4 + 2);
+  vec4 d = texelFetch(clusterPointLights, index * 4 + 3);
+  return PointLight(a.xyz, a.w, b.xyz, b.w, c.xyz, c.w, d.xyz, true);
+}
+
+// reads a spotlight out of its cluster buffer
+SpotLight fetchSpotLight(int index)
+{
+  vec4 a = texelFetch(clusterSpotLights, index * 6);
+  vec4 b = texelFetch(clusterSpotLights, index * 6 + 1);
+  vec4 c = texelFetch(clusterSpotLights, index * 6 + 2);
+  vec4 d = texelFetch(clusterSpotLights, index * 6 + 3);
+  vec4 e = texelFetch(clusterSpotLights, index * 6 + 4);
+  return SpotLight(a.xyz, a.w, b.xyz, b.w, c.xyz, c.w, d.xyz, d.w, e.xyz, e.w, true);
+}
+
+// samples the specular map, or gives no specular at all for meshes without one
+vec3 specularMap()
+{
+#if HAS_SPECULAR_MAP
+  return vec3(texture(material.texture_specular0, TexCoords));
+#else
+  return vec3(0.0);
+#endif
+}
@@ -1,18 +1,78 @@
 #version 330 core
+
+// packed meshes store positions as 0 to 1 across their bounds, and normals folded flat
+// into two numbers
+#ifndef PACKED_VERTICES
+#define PACKED_VERTICES 0
+#endif
+
+#if PACKED_VERTICES
+layout (location = 0) in vec3 aPackedPos;
+layout (location = 1) in vec2 aPackedNormal;
+uniform vec3 positionMin;
+uniform vec3 positionExtent;
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
+// meshes drawn from a geometry arena fetch their model matrix by draw id, and instanced
+// ones read it per instance, since they're all drawn at once
+#ifndef ARENA_DRAW
+#define ARENA_DRAW 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+
+#if ARENA_DRAW
+layout (location = 3) in uint aDrawID;
+uniform samplerBuffer arenaModels;
+#elif INSTANCED
+layout (location = 4) in mat4 aInstanceModel;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+layout (std140) uniform Camera {
+  mat4 view;
+  mat4 projection;
+  vec3 viewPos;
+  float time;
+  vec2 screenSize;
+  float nearPlane;
+  float farPlane;
+};
+
+#if PACKED_VERTICES
+// Unfolds an octahedral normal
+vec3 octahedralDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+#endif
 
 void main()
 {
+#if PACKED_VERTICES
+  vec3 aPos = positionMin + aPackedPos * positionExtent;
+  vec3 aNormal = octahedralDecode(aPackedNormal);
+#endif
+#if ARENA_DRAW
+  int base = int(aDrawID) * 4;
+  mat4 model = mat4(texelFetch(arenaModels, base), texelFetch(arenaModels, base + 1), texelFetch(arenaModels, base + 2), texelFetch(arenaModels, base + 3));
+#elif INSTANCED
+  mat4 model = aInstanceModel;
+#endif
+
   Normal = mat3(transpose(inverse(model))) * aNormal;
   FragPos = vec3(model * vec4(aPos, 1.0));
   TexCoords = aTexCoords;
@@ -0,0 +1,9 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform vec3 ParticleColor;
+
+void main()
+{
+  FragColor = vec4(ParticleColor, 1.0);
+}
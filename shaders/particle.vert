@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+layout (location = 1) in vec4 aParticle; // xyz is the position, w is the size
+
+layout (std140) uniform Camera {
+  mat4 view;
+  mat4 projection;
+  vec3 viewPos;
+  float time;
+  vec2 screenSize;
+  float nearPlane;
+  float farPlane;
+};
+
+void main()
+{
+  // the camera's right and up vectors are the first two rows of the view matrix
+  vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+  vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+  vec3 pos = aParticle.xyz + (right * aCorner.x + up * aCorner.y) * aParticle.w;
+
+  gl_Position = projection * view * vec4(pos, 1.0f);
+}
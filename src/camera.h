@@ -12,6 +12,8 @@ const float SPEED = 4.0f;
 const float MOUSE_SENS = 0.3f;
 const float ZOOM = 60.0f;
 const float SCROLL_SENS = 2.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
 
 enum Camera_Direction {
   FORWARD,
@@ -14,7 +14,9 @@
 
 // our files
 #include "shapes.h" // shape classes
+#include "collision.h" // for CollisionHit
 #include "utils.h" // utility functions
+#include "physicsstats.h" // for PHYSICS_COUNT
 
 // finds signed distance from a point to a plane defined by a triangle
 float signedDistanceToPlane(const Triangle &tri, const glm::vec3 &point)
@@ -33,26 +35,75 @@ bool pointInsideTriangle(const Triangle &tri, const glm::vec3 &point)
 	return true;
 }
 
-// finds the time and point at which ellipsoid intersects with a triangle
+// Collider space conversions, one per ColliderShape. Collider space is the space in which
+// the collider is a unit sphere, so spheres can skip most (or all) of the work that a
+// general ellipsoid needs.
+template <ColliderShape Shape>
+struct ColliderSpace;
+
+template <>
+struct ColliderSpace<UNIT_SPHERE>
+{
+	static glm::vec3 Point(const Ellipsoid&, const glm::vec3 &point) { return point; }
+	static const Triangle& Tri(const Ellipsoid&, const Triangle &tri) { return tri; }
+	static glm::vec3 Normal(const Ellipsoid&, const glm::vec3 &normal) { return glm::normalize(normal); }
+};
+
+template <>
+struct ColliderSpace<UNIFORM_SPHERE>
+{
+	static glm::vec3 Point(const Ellipsoid &ellip, const glm::vec3 &point) { return point * ellip.InvRadius; }
+	static Triangle Tri(const Ellipsoid &ellip, const Triangle &tri)
+	{
+		// a uniform scale doesn't change the normal, so there's no need to recompute it
+		Triangle ret = tri;
+		for (unsigned int i = 0; i < 3; ++i)
+			ret.Vertices[i] *= ellip.InvRadius;
+		return ret;
+	}
+	static glm::vec3 Normal(const Ellipsoid&, const glm::vec3 &normal) { return glm::normalize(normal); }
+};
+
+template <>
+struct ColliderSpace<ELLIPSOID>
+{
+	static glm::vec3 Point(const Ellipsoid &ellip, const glm::vec3 &point) { return ellip.toEllipSpace(point); }
+	static Triangle Tri(const Ellipsoid &ellip, const Triangle &tri) { return ellip.toEllipSpace(tri); }
+	static glm::vec3 Normal(const Ellipsoid &ellip, const glm::vec3 &normal) { return glm::normalize(ellip.toEllipSpace(normal)); }
+};
+
+template <>
+struct ColliderSpace<ORIENTED_ELLIPSOID>
+{
+	static glm::vec3 Point(const Ellipsoid &ellip, const glm::vec3 &point) { return ellip.ToCollider * point; }
+	static Triangle Tri(const Ellipsoid &ellip, const Triangle &tri)
+	{
+		return Triangle(ellip.ToCollider * tri.Vertices[0], ellip.ToCollider * tri.Vertices[1], ellip.ToCollider * tri.Vertices[2]);
+	}
+	// normals go back to world space through the transpose, like they would through the inverse
+	// transpose of the collider-to-world transform
+	static glm::vec3 Normal(const Ellipsoid &ellip, const glm::vec3 &normal) { return glm::normalize(glm::transpose(ellip.ToCollider) * normal); }
+};
+
+// finds the time and point at which a unit sphere intersects with a triangle, with
+// everything already in collider space
 // returns whether or not an intersection happens
 // based on http://www.peroxide.dk/papers/collision/collision.pdf
-bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float &collisionTime, glm::vec3 &slidingPlaneNormal)
+static bool sweepUnitSphere(const glm::vec3 &pos, const glm::vec3 &vel, const Triangle &tri, float &collisionTime, glm::vec3 &collisionPoint)
 {
 	// defining constants
 	float EPSILON = 0.00001;
 
-	// converting everything to ellipsoid space
-	glm::vec3 pos = ellip.toEllipSpace(ellip.Position);
-	glm::vec3 vel = ellip.toEllipSpace(ellip.Velocity);
-	Triangle tri = ellip.toEllipSpace(triangle);
-
 	// detecting whether the ellipsoid could even have a collision
 	float baseDistToPlane = signedDistanceToPlane(tri, pos);
 	float normDotVel = glm::dot(tri.Normal, vel);
 
 	// back face culling
 	if (normDotVel > 0)
+	{
+		PHYSICS_COUNT(PlaneRejects, 1);
 		return false;
+	}
 
 	// t0 is time when sphere enters plane, t1 is time when it exits
 	float t0, t1;
@@ -68,6 +119,7 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 		// checking for t0 and t1 being too big for collision to happen
 		if (t0 > 1.0f || t1 < 0.0f)
 		{
+			PHYSICS_COUNT(PlaneRejects, 1);
 			return false;
 		}
 
@@ -94,6 +146,7 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 		}
 		else
 		{
+			PHYSICS_COUNT(PlaneRejects, 1);
 			return false;
 		}
 	}
@@ -101,7 +154,7 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 	// defining some variables to set as collisions are detected
 	bool collision = false;
 	collisionTime = 1.0f;
-	glm::vec3 collisionPoint = glm::vec3(0.0f);
+	collisionPoint = glm::vec3(0.0f);
 
 	// proceeding with face intersection test:
 	if (!embedded)
@@ -117,8 +170,14 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 	}
 
 	// if a face collision happens, no other collision can theoretically happen
-	if (!collision)
+	if (collision)
+	{
+		PHYSICS_COUNT(FaceHits, 1);
+	}
+	else
 	{
+		PHYSICS_COUNT(QuadraticTests, 1);
+
 		// note: converting certain values to doubles instead of floats for calculations
 		//   reduces error by about 2 to 3 orders of magnitude on average
 
@@ -132,8 +191,10 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 			double c = std::pow(glm::length(tri.Vertices[i] - pos), 2) - 1.0f;
 
 			double r0, r1;
+			PHYSICS_COUNT(QuadraticSolves, 1);
 			if (solveQuadrat(a, b, c, r0, r1))
 			{
+				PHYSICS_COUNT(QuadraticRoots, 1);
 				double time = std::min(r0, r1);
 				if (time < 0 && time >= -0.05)
 					time = 0; // helps mitigate false negatives from calculation imprecision 
@@ -166,8 +227,10 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 			double c = edgeLenSquared * (1.0f - posToVertLenSquared) + edgeDotPosToVert * edgeDotPosToVert;
 
 			double r0, r1;
+			PHYSICS_COUNT(QuadraticSolves, 1);
 			if (solveQuadrat(a, b, c, r0, r1))
 			{
+				PHYSICS_COUNT(QuadraticRoots, 1);
 				double time = std::min(r0, r1);
 				if (time < 0 && time >= -0.05)
 					time = 0; // helps mitigate false negatives from calculation imprecision 
@@ -189,15 +252,53 @@ bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float
 		}
 	}
 
-	if (collision) {
-		slidingPlaneNormal = (pos + (vel * collisionTime)) - collisionPoint; 
-		slidingPlaneNormal = ellip.toEllipSpace(slidingPlaneNormal);
-		slidingPlaneNormal = glm::normalize(slidingPlaneNormal);
-	}
-
 	return collision;
 }
 
+// sweeps the ellipsoid (already converted to pos and vel) against a triangle already in
+// collider space, and finds the world space plane it should slide along afterwards
+template <ColliderShape Shape>
+static bool sweepCollider(const Ellipsoid &ellip, const glm::vec3 &pos, const glm::vec3 &vel, const Triangle &tri, float &collisionTime, glm::vec3 &slidingPlaneNormal)
+{
+	glm::vec3 collisionPoint;
+	if (!sweepUnitSphere(pos, vel, tri, collisionTime, collisionPoint))
+		return false;
+
+	slidingPlaneNormal = ColliderSpace<Shape>::Normal(ellip, (pos + (vel * collisionTime)) - collisionPoint);
+	return true;
+}
+
+// finds the time at which ellipsoid intersects with a triangle, and the plane it should
+// slide along afterwards. specialized on the ellipsoid's collider shape.
+// returns whether or not an intersection happens
+template <ColliderShape Shape>
+bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float &collisionTime, glm::vec3 &slidingPlaneNormal)
+{
+	// converting everything to collider space
+	glm::vec3 pos = ColliderSpace<Shape>::Point(ellip, ellip.Position);
+	glm::vec3 vel = ColliderSpace<Shape>::Point(ellip, ellip.Velocity);
+	const auto &tri = ColliderSpace<Shape>::Tri(ellip, triangle);
+
+	return sweepCollider<Shape>(ellip, pos, vel, tri, collisionTime, slidingPlaneNormal);
+}
+
+// finds the time at which ellipsoid intersects with a triangle, picking the specialization
+// that matches the ellipsoid's collider shape
+bool computeIntersection(const Ellipsoid &ellip, const Triangle &triangle, float &collisionTime, glm::vec3 &slidingPlaneNormal)
+{
+	switch (ellip.Shape)
+	{
+		case UNIT_SPHERE:
+			return computeIntersection<UNIT_SPHERE>(ellip, triangle, collisionTime, slidingPlaneNormal);
+		case UNIFORM_SPHERE:
+			return computeIntersection<UNIFORM_SPHERE>(ellip, triangle, collisionTime, slidingPlaneNormal);
+		case ORIENTED_ELLIPSOID:
+			return computeIntersection<ORIENTED_ELLIPSOID>(ellip, triangle, collisionTime, slidingPlaneNormal);
+		default:
+			return computeIntersection<ELLIPSOID>(ellip, triangle, collisionTime, slidingPlaneNormal);
+	}
+}
+
 // function overload for inputting vertices instead of a triangle
 bool computeIntersection(const Ellipsoid &ellip, const glm::vec3 &vert0, const glm::vec3 &vert1, const glm::vec3 &vert2, float &collisionTime, glm::vec3 &slidingPlaneNormal)
 {
@@ -205,24 +306,65 @@ bool computeIntersection(const Ellipsoid &ellip, const glm::vec3 &vert0, const g
 	return computeIntersection(ellip, tri, collisionTime, slidingPlaneNormal);
 }
 
-void handleIntersection(Ellipsoid &ellip, const std::vector<Triangle> &tris) 
+// converts triangles into the ellipsoid's collider space all at once, so that sweeping
+// against them over and over (every pass and substep) doesn't convert them each time
+template <ColliderShape Shape>
+void toColliderSpace(const Ellipsoid &ellip, const std::vector<Triangle> &tris, std::vector<Triangle> &colliderTris)
+{
+	colliderTris.clear();
+	colliderTris.reserve(tris.size());
+	for (unsigned int i = 0; i < tris.size(); ++i)
+		colliderTris.push_back(ColliderSpace<Shape>::Tri(ellip, tris[i]));
+}
+
+// converts triangles into the ellipsoid's collider space, picking the specialization that
+// matches the ellipsoid's collider shape
+void toColliderSpace(const Ellipsoid &ellip, const std::vector<Triangle> &tris, std::vector<Triangle> &colliderTris)
+{
+	switch (ellip.Shape)
+	{
+		case UNIT_SPHERE:
+			toColliderSpace<UNIT_SPHERE>(ellip, tris, colliderTris);
+			break;
+		case UNIFORM_SPHERE:
+			toColliderSpace<UNIFORM_SPHERE>(ellip, tris, colliderTris);
+			break;
+		case ORIENTED_ELLIPSOID:
+			toColliderSpace<ORIENTED_ELLIPSOID>(ellip, tris, colliderTris);
+			break;
+		default:
+			toColliderSpace<ELLIPSOID>(ellip, tris, colliderTris);
+			break;
+	}
+}
+
+// moves the ellipsoid through a frame of its velocity, sliding along any triangles it hits.
+// the triangles have to already be in the ellipsoid's collider space (see toColliderSpace).
+// specialized on the ellipsoid's collider shape, so the shape is only looked at once.
+// if hits is given, every triangle the ellipsoid slid along is appended to it.
+template <ColliderShape Shape>
+void handleColliderIntersection(Ellipsoid &ellip, const std::vector<Triangle> &colliderTris, std::vector<CollisionHit> *hits) 
 {
 	float EPSILON = 0.00001f;
 	float totalTimePassed = 0.0f;
 	unsigned int passes = 0;
+	PHYSICS_COUNT(Sweeps, 1);
 
 	while (totalTimePassed < 1.0f)
 	{
-		bool collision;
+		bool collision = false;
 		float collisionTime = 1.0f;
 		glm::vec3 slidingPlaneNormal;
+		unsigned int collisionIndex = 0;
+
+		glm::vec3 pos = ColliderSpace<Shape>::Point(ellip, ellip.Position);
+		glm::vec3 vel = ColliderSpace<Shape>::Point(ellip, ellip.Velocity);
 
-		// TODO: make an octree or something. anything to make this more efficient
-		for (unsigned int i = 0; i < tris.size(); ++i)
+		for (unsigned int i = 0; i < colliderTris.size(); ++i)
 		{
 			float currCollisionTime;
 			glm::vec3 currSlidingPlane;
-			if (computeIntersection(ellip, tris[i], currCollisionTime, currSlidingPlane))
+			if (sweepCollider<Shape>(ellip, pos, vel, colliderTris[i], currCollisionTime, currSlidingPlane))
 			{
 				// the second part of the following if-statement makes sure that the ellipsoid
 				// will not get stuck repeatedly colliding with something at time = 0
@@ -231,6 +373,7 @@ void handleIntersection(Ellipsoid &ellip, const std::vector<Triangle> &tris)
 					collision = true;
 					collisionTime = currCollisionTime;
 					slidingPlaneNormal = currSlidingPlane;
+					collisionIndex = i;
 				}
 			}
 		}
@@ -243,6 +386,9 @@ void handleIntersection(Ellipsoid &ellip, const std::vector<Triangle> &tris)
 
 			glm::vec3 projection = glm::dot(ellip.Velocity, glm::normalize(slidingPlaneNormal)) * glm::normalize(slidingPlaneNormal);
 			ellip.Velocity -= projection;
+
+			if (hits)
+				hits->push_back(CollisionHit{collisionIndex, glm::normalize(slidingPlaneNormal)});
 		}
 		else
 		{
@@ -253,13 +399,92 @@ void handleIntersection(Ellipsoid &ellip, const std::vector<Triangle> &tris)
 
 		totalTimePassed += collisionTime;
 
+		PHYSICS_COUNT(Passes, 1);
 		if (++passes >= 3)
+		{
+			if (totalTimePassed < 1.0f && glm::length(ellip.Velocity) >= EPSILON)
+				PHYSICS_COUNT(PassCapHits, 1);
 			break; // prevents hard-locking
+		}
 		if (glm::length(ellip.Velocity) < EPSILON)
 			break;
 	}
+}
 
-	// adding gravity and friction to velocity post-calculations
-	ellip.Velocity += glm::vec3(0.0f, -0.001f, 0.0f);
-	ellip.Velocity *= 0.99f;
+// moves the ellipsoid through a frame of its velocity, sliding along any triangles it hits.
+// specialized on the ellipsoid's collider shape, so the shape is only looked at once.
+// if hits is given, every triangle the ellipsoid slid along is appended to it.
+template <ColliderShape Shape>
+void handleIntersection(Ellipsoid &ellip, const std::vector<Triangle> &tris, std::vector<CollisionHit> *hits)
+{
+	// unit spheres are already in collider space
+	if (Shape == UNIT_SPHERE)
+	{
+		handleColliderIntersection<Shape>(ellip, tris, hits);
+		return;
+	}
+
+	std::vector<Triangle> colliderTris;
+	toColliderSpace<Shape>(ellip, tris, colliderTris);
+	handleColliderIntersection<Shape>(ellip, colliderTris, hits);
+}
+
+// moves the ellipsoid through a frame of its velocity, picking the specialization that
+// matches the ellipsoid's collider shape
+void handleIntersection(Ellipsoid &ellip, const std::vector<Triangle> &tris, std::vector<CollisionHit> *hits)
+{
+	switch (ellip.Shape)
+	{
+		case UNIT_SPHERE:
+			handleIntersection<UNIT_SPHERE>(ellip, tris, hits);
+			break;
+		case UNIFORM_SPHERE:
+			handleIntersection<UNIFORM_SPHERE>(ellip, tris, hits);
+			break;
+		case ORIENTED_ELLIPSOID:
+			handleIntersection<ORIENTED_ELLIPSOID>(ellip, tris, hits);
+			break;
+		default:
+			handleIntersection<ELLIPSOID>(ellip, tris, hits);
+			break;
+	}
 }
+
+// moves the ellipsoid through a frame of its velocity, against triangles already in its
+// collider space, picking the specialization that matches the ellipsoid's collider shape
+void handleColliderIntersection(Ellipsoid &ellip, const std::vector<Triangle> &colliderTris, std::vector<CollisionHit> *hits)
+{
+	switch (ellip.Shape)
+	{
+		case UNIT_SPHERE:
+			handleColliderIntersection<UNIT_SPHERE>(ellip, colliderTris, hits);
+			break;
+		case UNIFORM_SPHERE:
+			handleColliderIntersection<UNIFORM_SPHERE>(ellip, colliderTris, hits);
+			break;
+		case ORIENTED_ELLIPSOID:
+			handleColliderIntersection<ORIENTED_ELLIPSOID>(ellip, colliderTris, hits);
+			break;
+		default:
+			handleColliderIntersection<ELLIPSOID>(ellip, colliderTris, hits);
+			break;
+	}
+}
+
+// instantiating the versions of the collision functions we'll need
+template bool computeIntersection<UNIT_SPHERE>(const Ellipsoid&, const Triangle&, float&, glm::vec3&);
+template bool computeIntersection<UNIFORM_SPHERE>(const Ellipsoid&, const Triangle&, float&, glm::vec3&);
+template bool computeIntersection<ELLIPSOID>(const Ellipsoid&, const Triangle&, float&, glm::vec3&);
+template bool computeIntersection<ORIENTED_ELLIPSOID>(const Ellipsoid&, const Triangle&, float&, glm::vec3&);
+template void handleIntersection<UNIT_SPHERE>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleIntersection<UNIFORM_SPHERE>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleIntersection<ELLIPSOID>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleIntersection<ORIENTED_ELLIPSOID>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleColliderIntersection<UNIT_SPHERE>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleColliderIntersection<UNIFORM_SPHERE>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleColliderIntersection<ELLIPSOID>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void handleColliderIntersection<ORIENTED_ELLIPSOID>(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>*);
+template void toColliderSpace<UNIT_SPHERE>(const Ellipsoid&, const std::vector<Triangle>&, std::vector<Triangle>&);
+template void toColliderSpace<UNIFORM_SPHERE>(const Ellipsoid&, const std::vector<Triangle>&, std::vector<Triangle>&);
+template void toColliderSpace<ELLIPSOID>(const Ellipsoid&, const std::vector<Triangle>&, std::vector<Triangle>&);
+template void toColliderSpace<ORIENTED_ELLIPSOID>(const Ellipsoid&, const std::vector<Triangle>&, std::vector<Triangle>&);
@@ -10,10 +10,26 @@
 // our files
 #include "shapes.h"
 
+// a triangle that an ellipsoid slid along, and the normal of the plane it slid on
+struct CollisionHit {
+	unsigned int Index;
+	glm::vec3 Normal;
+};
+
 float signedDistanceToPlane(const Triangle&, const glm::vec3&);
 bool pointInsideTriangle(const Triangle&, const glm::vec3&);
-bool computeIntersection(const Ellipsoid&, const glm::vec3&, const glm::vec3&, const Triangle&, float&, glm::vec3&);
-bool computeIntersection(const Ellipsoid&, const glm::vec3&, const glm::vec3&, const glm::vec3&, const glm::vec3&, const glm::vec3&, float&, glm::vec3&); 
-void handleIntersection(Ellipsoid&, const std::vector<Triangle>&); 
+template <ColliderShape Shape>
+bool computeIntersection(const Ellipsoid&, const Triangle&, float&, glm::vec3&);
+bool computeIntersection(const Ellipsoid&, const Triangle&, float&, glm::vec3&);
+bool computeIntersection(const Ellipsoid&, const glm::vec3&, const glm::vec3&, const glm::vec3&, float&, glm::vec3&); 
+template <ColliderShape Shape>
+void toColliderSpace(const Ellipsoid&, const std::vector<Triangle>&, std::vector<Triangle>&);
+void toColliderSpace(const Ellipsoid&, const std::vector<Triangle>&, std::vector<Triangle>&);
+template <ColliderShape Shape>
+void handleIntersection(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>* = NULL);
+void handleIntersection(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>* = NULL);
+template <ColliderShape Shape>
+void handleColliderIntersection(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>* = NULL);
+void handleColliderIntersection(Ellipsoid&, const std::vector<Triangle>&, std::vector<CollisionHit>* = NULL);
 
 #endif
@@ -0,0 +1,210 @@
+// compressedoctree.cpp
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <cmath> // for floor, ceil
+#include <cstddef> // for size_t
+#include <algorithm> // for min, max
+using namespace std;
+
+// our files
+#include "compressedoctree.h" // for class declaration
+#include "octree.h" // for Octree class
+#include "shapes.h" // for Triangle class
+
+const unsigned int QUANT_STEPS = 65535;
+
+// Finds the value of a quantized step within [lo, hi]
+static float dequantize(unsigned int q, float lo, float hi) {
+	return lo + (hi - lo) * ((float)q / (float)QUANT_STEPS);
+}
+
+// Quantizes a lower bound, rounding down so the bound can only ever grow
+static unsigned short quantizeDown(float value, float lo, float hi) {
+	if (hi - lo <= 0.0f)
+		return 0;
+	float step = floor((value - lo) / (hi - lo) * (float)QUANT_STEPS);
+	unsigned int q = (step < 0.0f) ? 0 : (step > (float)QUANT_STEPS) ? QUANT_STEPS : (unsigned int)step;
+	while (q > 0 && dequantize(q, lo, hi) > value)
+		--q; // correcting for float error in the division
+	return q;
+}
+
+// Quantizes an upper bound, rounding up so the bound can only ever grow
+static unsigned short quantizeUp(float value, float lo, float hi) {
+	if (hi - lo <= 0.0f)
+		return QUANT_STEPS;
+	float step = ceil((value - lo) / (hi - lo) * (float)QUANT_STEPS);
+	unsigned int q = (step < 0.0f) ? 0 : (step > (float)QUANT_STEPS) ? QUANT_STEPS : (unsigned int)step;
+	while (q < QUANT_STEPS && dequantize(q, lo, hi) < value)
+		++q; // correcting for float error in the division
+	return q;
+}
+
+// Quantizes a vertex coordinate to the nearest step
+static unsigned short quantizeNearest(float value, float lo, float hi) {
+	if (hi - lo <= 0.0f)
+		return 0;
+	float step = floor((value - lo) / (hi - lo) * (float)QUANT_STEPS + 0.5f);
+	return (step < 0.0f) ? 0 : (step > (float)QUANT_STEPS) ? QUANT_STEPS : (unsigned int)step;
+}
+
+// CompressedOctree constructor, for an empty tree
+CompressedOctree::CompressedOctree() : rootMin(0.0f), rootMax(0.0f), maxVertexError(0.0f) {}
+
+// CompressedOctree constructor. Builds a full octree, then packs it down.
+CompressedOctree::CompressedOctree(const vector<Triangle> &tris) : rootMin(0.0f), rootMax(0.0f), maxVertexError(0.0f) {
+	if (tris.empty())
+		return;
+
+	Octree octree(tris);
+	rootMin = octree.boundsMin;
+	rootMax = octree.boundsMax;
+
+	nodes.resize(1);
+	quantizedVerts.reserve(tris.size() * 9);
+	triIDs.reserve(tris.size());
+	flatten(octree, 0, rootMin, rootMax, tris);
+
+	nodes.shrink_to_fit();
+}
+
+// Appends every triangle whose bounding box overlaps the query box. The triangles are the
+// quantized ones, so they can be up to MaxVertexError() away from the originals. If
+// maxError is given, it's set to how far off the triangles this query found can be, which
+// is usually a lot less: small nodes quantize finely.
+void CompressedOctree::Query(const glm::vec3 &queryMin, const glm::vec3 &queryMax, vector<Triangle> &out, float *maxError) const {
+	float error = 0.0f;
+	if (!nodes.empty())
+		query(0, rootMin, rootMax, queryMin, queryMax, out, error);
+	if (maxError)
+		*maxError = error;
+}
+
+// Gets the number of triangles in the tree
+unsigned int CompressedOctree::NumTriangles() const {
+	return triIDs.size();
+}
+
+// Gets the index the nth stored triangle had in the vector the tree was built from
+unsigned int CompressedOctree::TriangleID(unsigned int index) const {
+	return triIDs[index];
+}
+
+// Gets the furthest any quantized vertex ended up from where it really is
+float CompressedOctree::MaxVertexError() const {
+	return maxVertexError;
+}
+
+// Finds how many bytes the tree takes up
+size_t CompressedOctree::MemoryUsage() const {
+	return sizeof(CompressedOctree) + nodes.capacity() * sizeof(CompressedNode) + quantizedVerts.capacity() * sizeof(unsigned short) + triIDs.capacity() * sizeof(unsigned int);
+}
+
+// Finds how many bytes the tree takes up per triangle
+float CompressedOctree::BytesPerTriangle() const {
+	if (triIDs.empty())
+		return 0.0f;
+	return (float)MemoryUsage() / (float)triIDs.size();
+}
+
+// Packs an octree node (and its sub-octrees) into the given slot, quantized relative to
+// the bounds of its parent
+void CompressedOctree::flatten(const Octree &octree, unsigned int slot, const glm::vec3 &parentMin, const glm::vec3 &parentMax, const vector<Triangle> &tris) {
+	CompressedNode node;
+	for (unsigned int i = 0; i < 3; ++i) {
+		node.BoundsMin[i] = quantizeDown(octree.boundsMin[i], parentMin[i], parentMax[i]);
+		node.BoundsMax[i] = quantizeUp(octree.boundsMax[i], parentMin[i], parentMax[i]);
+	}
+	glm::vec3 boxMin, boxMax;
+	nodeBounds(node, parentMin, parentMax, boxMin, boxMax);
+
+	// quantizing this node's triangles relative to its bounds
+	node.FirstTri = triIDs.size();
+	node.NumTris = octree.octreeTris.size();
+	for (unsigned int i = 0; i < octree.octreeTris.size(); ++i) {
+		const Triangle &tri = tris[octree.octreeTris[i]];
+		for (unsigned int j = 0; j < 3; ++j) {
+			glm::vec3 decoded;
+			for (unsigned int k = 0; k < 3; ++k) {
+				unsigned short q = quantizeNearest(tri.Vertices[j][k], boxMin[k], boxMax[k]);
+				quantizedVerts.push_back(q);
+				decoded[k] = dequantize(q, boxMin[k], boxMax[k]);
+			}
+			float error = glm::length(decoded - tri.Vertices[j]);
+			if (error > maxVertexError)
+				maxVertexError = error;
+		}
+		triIDs.push_back(octree.octreeTris[i]);
+	}
+
+	// reserving contiguous slots for the non-empty sub-octrees, then filling them in
+	vector<const Octree*> children;
+	for (unsigned int i = 0; i < octree.subOctrees.size(); ++i) {
+		if (octree.subOctrees[i].boundsMin.x <= octree.subOctrees[i].boundsMax.x)
+			children.push_back(&octree.subOctrees[i]);
+	}
+	node.FirstChild = nodes.size();
+	node.NumChildren = children.size();
+	nodes[slot] = node;
+	nodes.resize(nodes.size() + children.size());
+
+	for (unsigned int i = 0; i < children.size(); ++i) {
+		flatten(*children[i], node.FirstChild + i, boxMin, boxMax, tris);
+	}
+}
+
+// Collects overlapping triangles from a node and its children
+void CompressedOctree::query(unsigned int slot, const glm::vec3 &parentMin, const glm::vec3 &parentMax, const glm::vec3 &queryMin, const glm::vec3 &queryMax, vector<Triangle> &out, float &maxError) const {
+	const CompressedNode &node = nodes[slot];
+	glm::vec3 boxMin, boxMax;
+	nodeBounds(node, parentMin, parentMax, boxMin, boxMax);
+
+	if (queryMin.x > boxMax.x || queryMax.x < boxMin.x ||
+	    queryMin.y > boxMax.y || queryMax.y < boxMin.y ||
+	    queryMin.z > boxMax.z || queryMax.z < boxMin.z)
+		return;
+
+	// a vertex is off by at most half a step on each axis, so a whole step is a safe bound
+	// even after float rounding. the measured max across the tree's a bound too.
+	float nodeError = min(glm::length(boxMax - boxMin) / (float)QUANT_STEPS, maxVertexError);
+
+	for (unsigned int i = 0; i < node.NumTris; ++i) {
+		Triangle tri = decodeTriangle(node.FirstTri + i, boxMin, boxMax);
+		glm::vec3 triMin, triMax;
+		triangleBounds(tri, triMin, triMax);
+		if (queryMin.x > triMax.x || queryMax.x < triMin.x ||
+		    queryMin.y > triMax.y || queryMax.y < triMin.y ||
+		    queryMin.z > triMax.z || queryMax.z < triMin.z)
+			continue;
+		out.push_back(tri);
+		maxError = max(maxError, nodeError);
+	}
+
+	for (unsigned int i = 0; i < node.NumChildren; ++i) {
+		query(node.FirstChild + i, boxMin, boxMax, queryMin, queryMax, out, maxError);
+	}
+}
+
+// Unpacks a node's bounds, given its parent's bounds
+void CompressedOctree::nodeBounds(const CompressedNode &node, const glm::vec3 &parentMin, const glm::vec3 &parentMax, glm::vec3 &boxMin, glm::vec3 &boxMax) const {
+	for (unsigned int i = 0; i < 3; ++i) {
+		boxMin[i] = dequantize(node.BoundsMin[i], parentMin[i], parentMax[i]);
+		boxMax[i] = dequantize(node.BoundsMax[i], parentMin[i], parentMax[i]);
+	}
+}
+
+// Unpacks a triangle, given the bounds of the node it's in
+Triangle CompressedOctree::decodeTriangle(unsigned int index, const glm::vec3 &boxMin, const glm::vec3 &boxMax) const {
+	glm::vec3 verts[3];
+	const unsigned short *q = &quantizedVerts[index * 9];
+	for (unsigned int j = 0; j < 3; ++j) {
+		for (unsigned int k = 0; k < 3; ++k) {
+			verts[j][k] = dequantize(q[j * 3 + k], boxMin[k], boxMax[k]);
+		}
+	}
+	return Triangle(verts[0], verts[1], verts[2]);
+}
@@ -0,0 +1,56 @@
+#ifndef COMPRESSEDOCTREE_H
+#define COMPRESSEDOCTREE_H
+// compressedoctree.h
+// Defines the CompressedOctree class, a read-only octree with quantized bounds and
+// triangles, used to keep very large levels' collision data small.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <cstddef> // for size_t
+
+// our files
+#include "shapes.h" // for Triangle class
+#include "octree.h" // for Octree class
+
+// A single node. Its bounds are quantized to 16 bits relative to its parent's bounds, and
+// its triangles are quantized to 16 bits relative to its own bounds. Children are stored
+// contiguously, and so are each node's triangles.
+struct CompressedNode {
+	unsigned short BoundsMin[3];
+	unsigned short BoundsMax[3];
+	unsigned short NumChildren;
+	unsigned int FirstChild;
+	unsigned int FirstTri;
+	unsigned int NumTris;
+};
+
+class CompressedOctree {
+	public:
+		CompressedOctree();
+		CompressedOctree(const std::vector<Triangle>&);
+
+		void Query(const glm::vec3&, const glm::vec3&, std::vector<Triangle>&, float *maxError = NULL) const;
+
+		unsigned int NumTriangles() const;
+		unsigned int TriangleID(unsigned int) const;
+		float MaxVertexError() const;
+		size_t MemoryUsage() const;
+		float BytesPerTriangle() const;
+
+	private:
+		glm::vec3 rootMin, rootMax;
+		std::vector<CompressedNode> nodes;
+		std::vector<unsigned short> quantizedVerts; // 9 per triangle
+		std::vector<unsigned int> triIDs; // index each triangle had when the tree was built
+		float maxVertexError;
+
+		void flatten(const Octree&, unsigned int, const glm::vec3&, const glm::vec3&, const std::vector<Triangle>&);
+		void query(unsigned int, const glm::vec3&, const glm::vec3&, const glm::vec3&, const glm::vec3&, std::vector<Triangle>&, float&) const;
+		void nodeBounds(const CompressedNode&, const glm::vec3&, const glm::vec3&, glm::vec3&, glm::vec3&) const;
+		Triangle decodeTriangle(unsigned int, const glm::vec3&, const glm::vec3&) const;
+};
+
+#endif
@@ -0,0 +1,231 @@
+// frustum.cpp
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <algorithm> // for min, max
+#include <cmath> // for abs, sqrt
+#include <cfloat> // for FLT_MAX
+using namespace std;
+
+// our files
+#include "frustum.h" // for Bounds, FrustumCuller declarations
+#include "occlusion.h" // for OcclusionBuffer class
+#include "portals.h" // for CellGraph class
+
+// Makes Bounds around nothing, which anything merged into replaces
+Bounds emptyBounds() {
+	Bounds bounds;
+	bounds.Min = glm::vec3(FLT_MAX);
+	bounds.Max = glm::vec3(-FLT_MAX);
+	bounds.Center = glm::vec3(0.0f);
+	bounds.Radius = -1.0f;
+	return bounds;
+}
+
+// Makes Bounds around some points. The sphere is centered on the box, but only as big as
+// the farthest point needs, so it's usually a fair bit smaller than the box's corners.
+Bounds boundsOfPoints(const glm::vec3 *points, unsigned int count) {
+	Bounds bounds = emptyBounds();
+	if (count == 0)
+		return bounds;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		bounds.Min = glm::min(bounds.Min, points[i]);
+		bounds.Max = glm::max(bounds.Max, points[i]);
+	}
+	bounds.Center = (bounds.Min + bounds.Max) * 0.5f;
+
+	float farthest = 0.0f;
+	for (unsigned int i = 0; i < count; ++i) {
+		glm::vec3 offset = points[i] - bounds.Center;
+		farthest = max(farthest, glm::dot(offset, offset));
+	}
+	bounds.Radius = sqrt(farthest);
+	return bounds;
+}
+
+// Makes Bounds around two others
+Bounds mergeBounds(const Bounds &a, const Bounds &b) {
+	if (boundsEmpty(a))
+		return b;
+	if (boundsEmpty(b))
+		return a;
+
+	Bounds bounds;
+	bounds.Min = glm::min(a.Min, b.Min);
+	bounds.Max = glm::max(a.Max, b.Max);
+	bounds.Center = (bounds.Min + bounds.Max) * 0.5f;
+	bounds.Radius = max(glm::length(a.Center - bounds.Center) + a.Radius, glm::length(b.Center - bounds.Center) + b.Radius);
+	return bounds;
+}
+
+// Checks whether Bounds are around nothing
+bool boundsEmpty(const Bounds &bounds) {
+	return bounds.Radius < 0.0f;
+}
+
+// Pulls the six planes (left, right, bottom, top, near, far) out of projection * view,
+// normalized and pointing inwards
+void frustumPlanes(const glm::mat4 &viewProjection, glm::vec4 *planes) {
+	// each plane is the last row of the matrix plus or minus one of the others (glm's
+	// matrices are column major, so m[col][row])
+	const glm::mat4 &m = viewProjection;
+	glm::vec4 rows[4];
+	for (unsigned int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	for (unsigned int i = 0; i < 3; ++i) {
+		planes[i * 2] = rows[3] + rows[i];
+		planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+
+	// normalizing, so plane tests give actual distances to compare radii with
+	for (unsigned int i = 0; i < 6; ++i)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+// FrustumCuller Constructor. Everything's visible until a frustum's set.
+FrustumCuller::FrustumCuller() : occlusion(NULL), cells(NULL), drawn(0), culled(0), occluded(0), unreachable(0) {
+	for (unsigned int i = 0; i < 6; ++i)
+		planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, FLT_MAX);
+}
+
+// Sets the frustum to cull against from projection * view, and starts counting again
+void FrustumCuller::SetFrustum(const glm::mat4 &viewProjection) {
+	frustumPlanes(viewProjection, planes);
+
+	drawn = 0;
+	culled = 0;
+	occluded = 0;
+	unreachable = 0;
+}
+
+// Sets the occlusion buffer to test what's in the frustum against, or NULL for none. It
+// should already be finished for the frame.
+void FrustumCuller::SetOcclusion(OcclusionBuffer *buffer) {
+	occlusion = buffer;
+}
+
+// Sets the cell graph whose visible cells things have to be in, or NULL for none. Its
+// visible cells should already be found for the frame.
+void FrustumCuller::SetCells(const CellGraph *graph) {
+	cells = graph;
+}
+
+// Empties the batch
+void FrustumCuller::Clear() {
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+	radius.clear();
+	distance.clear();
+}
+
+// Adds Bounds to the batch, moved into world space by the given model matrix. Returns its
+// index in the batch.
+unsigned int FrustumCuller::Add(const Bounds &bounds, const glm::mat4 &model) {
+	glm::vec3 center = glm::vec3(model * glm::vec4(bounds.Center, 1.0f));
+	glm::vec3 extents = (bounds.Max - bounds.Min) * 0.5f;
+
+	// the box stays axis aligned, so it grows to fit around the rotated one
+	glm::mat3 axes = glm::mat3(model);
+	glm::vec3 worldExtents(0.0f);
+	for (unsigned int i = 0; i < 3; ++i)
+		worldExtents += glm::abs(axes[i]) * extents[i];
+
+	// and the sphere's scaled by the most the matrix stretches anything
+	float scale = max(glm::length(axes[0]), max(glm::length(axes[1]), glm::length(axes[2])));
+
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(worldExtents.x);
+	extentY.push_back(worldExtents.y);
+	extentZ.push_back(worldExtents.z);
+	radius.push_back(boundsEmpty(bounds) ? -FLT_MAX : bounds.Radius * scale);
+	distance.push_back(FLT_MAX);
+	return centerX.size() - 1;
+}
+
+// Culls the batch against the frustum. Each plane's test over the batch only reads and
+// writes plain float arrays, so it vectorizes.
+void FrustumCuller::Cull() {
+	unsigned int count = centerX.size();
+	const float *__restrict cx = centerX.data(), *__restrict cy = centerY.data(), *__restrict cz = centerZ.data();
+	const float *__restrict ex = extentX.data(), *__restrict ey = extentY.data(), *__restrict ez = extentZ.data();
+	const float *__restrict r = radius.data();
+	float *__restrict dist = distance.data();
+
+	for (unsigned int i = 0; i < count; ++i)
+		dist[i] = FLT_MAX;
+
+	for (unsigned int p = 0; p < 6; ++p) {
+		float nx = planes[p].x, ny = planes[p].y, nz = planes[p].z, w = planes[p].w;
+		float ax = abs(nx), ay = abs(ny), az = abs(nz);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			float centerDist = nx * cx[i] + ny * cy[i] + nz * cz[i] + w;
+			float boxRadius = ax * ex[i] + ay * ey[i] + az * ez[i];
+			dist[i] = min(dist[i], centerDist + min(boxRadius, r[i]));
+		}
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		if (dist[i] < 0.0f) {
+			++culled;
+			continue;
+		}
+
+		// what's left has its box checked against the cells and occluders, one at a time
+		glm::vec3 center(cx[i], cy[i], cz[i]), extents(ex[i], ey[i], ez[i]);
+		if (cells && !cells->BoxVisible(center - extents, center + extents)) {
+			dist[i] = -1.0f;
+			++unreachable;
+			continue;
+		}
+		if (occlusion) {
+			if (!occlusion->BoxVisible(center - extents, center + extents)) {
+				dist[i] = -1.0f;
+				++occluded;
+				continue;
+			}
+		}
+		++drawn;
+	}
+}
+
+// Checks whether something in the batch survived the last Cull
+bool FrustumCuller::Visible(unsigned int index) const {
+	return distance[index] >= 0.0f;
+}
+
+// Gets how many Bounds are in the batch
+unsigned int FrustumCuller::Size() const {
+	return centerX.size();
+}
+
+// Gets how many things have been visible since the frustum was set
+unsigned int FrustumCuller::NumDrawn() const {
+	return drawn;
+}
+
+// Gets how many things have been culled as outside the frustum since it was set
+unsigned int FrustumCuller::NumCulled() const {
+	return culled;
+}
+
+// Gets how many things in the frustum have been found hidden by occluders since it was set
+unsigned int FrustumCuller::NumOccluded() const {
+	return occluded;
+}
+
+// Gets how many things in the frustum have been in cells that can't be seen since it was set
+unsigned int FrustumCuller::NumUnreachable() const {
+	return unreachable;
+}
@@ -0,0 +1,73 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+// frustum.h
+// Defines the Bounds struct that meshes are culled by, and the FrustumCuller class, which
+// skips whatever's outside the camera's view.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+
+// our files
+#include "occlusion.h" // for OcclusionBuffer class
+#include "portals.h" // for CellGraph class
+
+// A box and a sphere around some geometry, in its own (model) space
+struct Bounds {
+	glm::vec3 Min;
+	glm::vec3 Max;
+	glm::vec3 Center; // of the box, which the sphere shares
+	float Radius;
+};
+
+Bounds emptyBounds();
+Bounds boundsOfPoints(const glm::vec3*, unsigned int);
+Bounds mergeBounds(const Bounds&, const Bounds&);
+bool boundsEmpty(const Bounds&);
+
+void frustumPlanes(const glm::mat4&, glm::vec4*);
+
+// FrustumCuller class
+// Bounds are added in batches, each transformed into world space by its model matrix and
+// stored as separate arrays per component. Culling a batch then tests all of them against
+// each frustum plane in a straight loop the compiler can vectorize. Something's visible if
+// both its box and its sphere are at least partly inside every plane, its box is in a cell
+// that can be seen (given a cell graph), and it isn't hidden behind the occluders (given an
+// occlusion buffer).
+class FrustumCuller {
+	public:
+		FrustumCuller();
+
+		void SetFrustum(const glm::mat4&);
+		void SetOcclusion(OcclusionBuffer*);
+		void SetCells(const CellGraph*);
+
+		void Clear();
+		unsigned int Add(const Bounds&, const glm::mat4&);
+		void Cull();
+		bool Visible(unsigned int) const;
+		unsigned int Size() const;
+
+		unsigned int NumDrawn() const;
+		unsigned int NumCulled() const;
+		unsigned int NumOccluded() const;
+		unsigned int NumUnreachable() const;
+
+	private:
+		glm::vec4 planes[6]; // left, right, bottom, top, near, far, pointing inwards
+
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+		std::vector<float> radius;
+		std::vector<float> distance; // how far inside the closest plane each one is, after culling
+
+		OcclusionBuffer *occlusion;
+		const CellGraph *cells;
+
+		// since the frustum was last set, so over a whole frame
+		unsigned int drawn, culled, occluded, unreachable;
+};
+
+#endif
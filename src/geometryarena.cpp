@@ -0,0 +1,475 @@
+// geometryarena.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags, GLADloadproc
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <algorithm> // for stable_sort, max
+#include <iostream> // for cout, endl
+#include <cstring> // for strcmp
+
+// our files
+#include "geometryarena.h" // for GeometryArena declaration
+#include "mesh.h" // for Mesh class, Vertex struct
+#include "shader.h" // for Shader class
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle, TextureHandle, streamBuffer
+
+// the bits of GL 4.3 we need, since glad only has 3.3
+#define DRAW_INDIRECT_BUFFER 0x8F3F
+
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum, GLenum, const void*, GLsizei, GLsizei);
+static MultiDrawElementsIndirectProc multiDrawElementsIndirect = NULL;
+
+// Checks whether the current context has multi-draw indirect, from its version or its
+// extensions. Submit also needs each command's base instance to step the draw id, which
+// is only honoured from gl 4.2 or with ARB_base_instance (before that it has to be zero).
+static bool hasMultiDraw()
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 3))
+		return true;
+
+	bool multiDraw = false;
+	bool baseInstance = (major == 4 && minor >= 2);
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint i = 0; i < numExtensions; ++i)
+	{
+		const char *name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (name == NULL)
+			continue;
+		if (strcmp(name, "GL_ARB_multi_draw_indirect") == 0)
+			multiDraw = true;
+		else if (strcmp(name, "GL_ARB_base_instance") == 0)
+			baseInstance = true;
+	}
+	return multiDraw && baseInstance;
+}
+
+// Loads the multi-draw function, if the driver has it. Some loaders (glx) hand back a
+// pointer for any name at all, so the context has to say it supports it too.
+bool initMultiDraw(GLADloadproc load)
+{
+	multiDrawElementsIndirect = NULL;
+	if (!hasMultiDraw())
+		return false;
+
+	multiDrawElementsIndirect = (MultiDrawElementsIndirectProc)load("glMultiDrawElementsIndirect");
+	return multiDrawElementsIndirect != NULL;
+}
+
+// Checks whether two meshes use the same textures, and so can go in the same multi-draw
+static bool sameTextures(const Mesh *a, const Mesh *b)
+{
+	if (a->textures.size() != b->textures.size())
+		return false;
+	for (unsigned int i = 0; i < a->textures.size(); ++i)
+	{
+		if (a->textures[i].id != b->textures[i].id)
+			return false;
+	}
+	return true;
+}
+
+// Orders meshes by their textures, so ones with the same textures end up next to each other
+static bool texturesBefore(const Mesh *a, const Mesh *b)
+{
+	unsigned int count = std::min(a->textures.size(), b->textures.size());
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (a->textures[i].id != b->textures[i].id)
+			return a->textures[i].id < b->textures[i].id;
+	}
+	return a->textures.size() < b->textures.size();
+}
+
+// RangeAllocator Constructor, with the whole capacity free
+RangeAllocator::RangeAllocator(unsigned int capacity) : capacity(0), used(0)
+{
+	Grow(capacity);
+}
+
+// Finds space for count items, giving back where it starts. Returns false if there's no
+// free range big enough.
+bool RangeAllocator::Allocate(unsigned int count, unsigned int &offset)
+{
+	for (unsigned int i = 0; i < freeRanges.size(); ++i)
+	{
+		if (freeRanges[i].Count < count)
+			continue;
+
+		offset = freeRanges[i].Offset;
+		freeRanges[i].Offset += count;
+		freeRanges[i].Count -= count;
+		if (freeRanges[i].Count == 0)
+			freeRanges.erase(freeRanges.begin() + i);
+		used += count;
+		return true;
+	}
+	return false;
+}
+
+// Gives a range back, merging it with the free ranges on either side of it
+void RangeAllocator::Free(unsigned int offset, unsigned int count)
+{
+	if (count == 0)
+		return;
+	used -= count;
+
+	unsigned int i = 0;
+	while (i < freeRanges.size() && freeRanges[i].Offset < offset)
+		++i;
+
+	FreeRange range = {offset, count};
+	freeRanges.insert(freeRanges.begin() + i, range);
+
+	if (i + 1 < freeRanges.size() && freeRanges[i].Offset + freeRanges[i].Count == freeRanges[i + 1].Offset)
+	{
+		freeRanges[i].Count += freeRanges[i + 1].Count;
+		freeRanges.erase(freeRanges.begin() + i + 1);
+	}
+	if (i > 0 && freeRanges[i - 1].Offset + freeRanges[i - 1].Count == freeRanges[i].Offset)
+	{
+		freeRanges[i - 1].Count += freeRanges[i].Count;
+		freeRanges.erase(freeRanges.begin() + i);
+	}
+}
+
+// Adds space onto the end
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	unsigned int added = newCapacity - capacity;
+	if (!freeRanges.empty() && freeRanges.back().Offset + freeRanges.back().Count == capacity)
+	{
+		freeRanges.back().Count += added;
+	}
+	else
+	{
+		FreeRange range = {capacity, added};
+		freeRanges.push_back(range);
+	}
+	capacity = newCapacity;
+}
+
+// Gets how many items there's room for
+unsigned int RangeAllocator::Capacity() const
+{
+	return capacity;
+}
+
+// Gets how many items are handed out
+unsigned int RangeAllocator::Used() const
+{
+	return used;
+}
+
+// GeometryArena Constructor. Makes the buffers at the given sizes (in vertices and
+// indices), which get bigger when they run out.
+GeometryArena::GeometryArena(unsigned int vertexCapacity, unsigned int indexCapacity) : drawIDCapacity(0), lastDraws(0), lastCalls(0)
+{
+	VAO = VertexArrayHandle::Create();
+	VBO = BufferHandle::Create();
+	EBO = BufferHandle::Create();
+	drawIDs = BufferHandle::Create();
+	commandBuffer = BufferHandle::Create();
+	modelBuffer = BufferHandle::Create();
+	modelTexture = TextureHandle::Create();
+
+	vertexRanges.Grow(vertexCapacity);
+	indexRanges.Grow(indexCapacity);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+	// the model matrices are read as four vec4s each
+	glBindBuffer(GL_TEXTURE_BUFFER, modelBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+	glBindTexture(GL_TEXTURE_BUFFER, modelTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, modelBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	setupVertexArray();
+}
+
+// Uploads a mesh's vertices and indices into free space, growing the arena if there isn't
+// any. The indices are left relative to the mesh's first vertex.
+bool GeometryArena::Allocate(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, ArenaRange &range)
+{
+	range.NumVertices = vertices.size();
+	range.NumIndices = indices.size();
+
+	if (!vertexRanges.Allocate(range.NumVertices, range.FirstVertex))
+	{
+		grow(std::max(vertexRanges.Capacity() * 2, vertexRanges.Capacity() + range.NumVertices), indexRanges.Capacity());
+		if (!vertexRanges.Allocate(range.NumVertices, range.FirstVertex))
+			return false;
+	}
+	if (!indexRanges.Allocate(range.NumIndices, range.FirstIndex))
+	{
+		grow(vertexRanges.Capacity(), std::max(indexRanges.Capacity() * 2, indexRanges.Capacity() + range.NumIndices));
+		if (!indexRanges.Allocate(range.NumIndices, range.FirstIndex))
+		{
+			vertexRanges.Free(range.FirstVertex, range.NumVertices);
+			return false;
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, range.FirstVertex * sizeof(Vertex), range.NumVertices * sizeof(Vertex), vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the element buffer is part of the vertex array's state, so it has to be bound through it
+	glBindVertexArray(VAO);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.FirstIndex * sizeof(unsigned int), range.NumIndices * sizeof(unsigned int), indices.data());
+	glBindVertexArray(0);
+	return true;
+}
+
+// Gives a mesh's space back
+void GeometryArena::Free(const ArenaRange &range)
+{
+	vertexRanges.Free(range.FirstVertex, range.NumVertices);
+	indexRanges.Free(range.FirstIndex, range.NumIndices);
+}
+
+// Adds a mesh to be drawn with the given model matrix on the next Submit
+void GeometryArena::Queue(Mesh *mesh, const ArenaRange &range, const glm::mat4 &model)
+{
+	QueuedDraw draw = {mesh, range, model};
+	queue.push_back(draw);
+}
+
+// Draws everything queued with the given shader (an ARENA_DRAW variant), then empties
+// the queue
+void GeometryArena::Submit(Shader &shader)
+{
+	lastDraws = queue.size();
+	lastCalls = 0;
+	if (queue.empty())
+		return;
+
+	// grouping draws by texture set, since textures can only change between calls
+	std::stable_sort(queue.begin(), queue.end(), [](const QueuedDraw &a, const QueuedDraw &b) { return texturesBefore(a.DrawMesh, b.DrawMesh); });
+
+	unsigned int count = queue.size();
+	models.resize(count);
+	commands.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const ArenaRange &range = queue[i].Range;
+		models[i] = queue[i].Model;
+
+		// the base instance is the draw id, which steps the draw id attribute along
+		DrawCommand command = {range.NumIndices, 1, range.FirstIndex, (int)range.FirstVertex, i};
+		commands[i] = command;
+	}
+
+	streamBuffer(GL_TEXTURE_BUFFER, modelBuffer, count * sizeof(glm::mat4), count * sizeof(glm::mat4), models.data());
+
+	shader.use();
+	shader.setInt("arenaModels", ARENA_TEXTURE_UNIT);
+	glActiveTexture(GL_TEXTURE0 + ARENA_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, modelTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (multiDrawElementsIndirect != NULL)
+	{
+		reserveDraws(count);
+		glBindBuffer(DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBufferData(DRAW_INDIRECT_BUFFER, count * sizeof(DrawCommand), commands.data(), GL_STREAM_DRAW);
+	}
+
+	glBindVertexArray(VAO);
+	unsigned int start = 0;
+	while (start < count)
+	{
+		unsigned int end = start + 1;
+		while (end < count && sameTextures(queue[start].DrawMesh, queue[end].DrawMesh))
+			++end;
+
+		queue[start].DrawMesh->BindTextures(shader);
+		if (multiDrawElementsIndirect != NULL)
+		{
+			multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(start * sizeof(DrawCommand)), end - start, 0);
+			++lastCalls;
+		}
+		else
+		{
+			// gl 3.3 has no base instance, so the draw id is set as a constant attribute instead
+			for (unsigned int i = start; i < end; ++i)
+			{
+				glVertexAttribI1ui(ARENA_DRAW_ID_ATTRIB, i);
+				glDrawElementsBaseVertex(GL_TRIANGLES, commands[i].Count, GL_UNSIGNED_INT, (void*)(commands[i].FirstIndex * sizeof(unsigned int)), commands[i].BaseVertex);
+				++lastCalls;
+			}
+		}
+		start = end;
+	}
+	glBindVertexArray(0);
+
+	if (multiDrawElementsIndirect != NULL)
+		glBindBuffer(DRAW_INDIRECT_BUFFER, 0);
+	queue.clear();
+}
+
+// Gets the vertex array every mesh in the arena is drawn through
+unsigned int GeometryArena::GetVAO() const
+{
+	return VAO;
+}
+
+// Checks whether the arena draws with glMultiDrawElementsIndirect
+bool GeometryArena::MultiDraw() const
+{
+	return multiDrawElementsIndirect != NULL;
+}
+
+// Gets how many meshes the last Submit drew
+unsigned int GeometryArena::NumDraws() const
+{
+	return lastDraws;
+}
+
+// Gets how many draw calls the last Submit took
+unsigned int GeometryArena::NumCalls() const
+{
+	return lastCalls;
+}
+
+// Makes the buffers bigger, copying what's already in them across
+void GeometryArena::grow(unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+	if (vertexCapacity > vertexRanges.Capacity())
+	{
+		BufferHandle bigger = BufferHandle::Create();
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+		glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexRanges.Capacity() * sizeof(Vertex));
+		VBO = std::move(bigger);
+		vertexRanges.Grow(vertexCapacity);
+	}
+	if (indexCapacity > indexRanges.Capacity())
+	{
+		BufferHandle bigger = BufferHandle::Create();
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+		glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, indexRanges.Capacity() * sizeof(unsigned int));
+		EBO = std::move(bigger);
+		indexRanges.Grow(indexCapacity);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// the vertex array still points at the old buffers
+	setupVertexArray();
+}
+
+// Points the vertex array at the arena's buffers, laid out the same as a Mesh's
+void GeometryArena::setupVertexArray()
+{
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	glEnableVertexAttribArray(2);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+	// the draw id, once per instance. Only multi-draw has base instances to step it along
+	// with, so the fallback leaves the array off and sets it per draw.
+	if (multiDrawElementsIndirect != NULL && drawIDCapacity > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, drawIDs);
+		glVertexAttribIPointer(ARENA_DRAW_ID_ATTRIB, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+		glVertexAttribDivisor(ARENA_DRAW_ID_ATTRIB, 1);
+		glEnableVertexAttribArray(ARENA_DRAW_ID_ATTRIB);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Makes sure there are enough draw ids for count draws
+void GeometryArena::reserveDraws(unsigned int count)
+{
+	if (count <= drawIDCapacity)
+		return;
+
+	drawIDCapacity = std::max(count, drawIDCapacity * 2);
+	std::vector<unsigned int> ids(drawIDCapacity);
+	for (unsigned int i = 0; i < drawIDCapacity; ++i)
+	{
+		ids[i] = i;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDs);
+	glBufferData(GL_ARRAY_BUFFER, drawIDCapacity * sizeof(unsigned int), ids.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	setupVertexArray();
+}
+
+// ArenaAllocation Constructor, which owns nothing
+ArenaAllocation::ArenaAllocation() : arena(NULL)
+{
+	range = ArenaRange();
+}
+
+// ArenaAllocation Constructor, taking ownership of a range that's already been allocated
+ArenaAllocation::ArenaAllocation(GeometryArena *arena, const ArenaRange &range) : arena(arena), range(range)
+{
+}
+
+// ArenaAllocation Destructor
+ArenaAllocation::~ArenaAllocation()
+{
+	if (arena != NULL)
+		arena->Free(range);
+}
+
+// ArenaAllocation Move Constructor. The allocation moved from is left owning nothing.
+ArenaAllocation::ArenaAllocation(ArenaAllocation &&other) noexcept : arena(other.arena), range(other.range)
+{
+	other.arena = NULL;
+}
+
+// ArenaAllocation Move Assignment, freeing whatever this owned before
+ArenaAllocation& ArenaAllocation::operator=(ArenaAllocation &&other) noexcept
+{
+	if (this != &other)
+	{
+		if (arena != NULL)
+			arena->Free(range);
+		arena = other.arena;
+		range = other.range;
+		other.arena = NULL;
+	}
+	return *this;
+}
+
+// Gets the arena the range is in, or NULL if this owns nothing
+GeometryArena* ArenaAllocation::Arena() const
+{
+	return arena;
+}
+
+// Gets the range
+const ArenaRange& ArenaAllocation::Range() const
+{
+	return range;
+}
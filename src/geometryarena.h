@@ -0,0 +1,142 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+// geometryarena.h
+// Defines the GeometryArena class, one big vertex and index buffer that many meshes live
+// in, so they can all be drawn without switching buffers between them.
+
+// libraries
+#include <glad/glad.h> // for opengl flags, GLADloadproc
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+
+// our files
+#include "shader.h" // for Shader class
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle, TextureHandle
+
+class Mesh;
+struct Vertex;
+
+const unsigned int ARENA_VERTICES = 1 << 18; // starting size, it grows as needed
+const unsigned int ARENA_INDICES = 1 << 20;
+const unsigned int ARENA_DRAW_ID_ATTRIB = 3; // the attribute object.vert reads the draw id from
+const unsigned int ARENA_TEXTURE_UNIT = 12; // where the per-draw model matrices are bound
+
+// Loads glMultiDrawElementsIndirect (GL 4.3), which glad's 3.3 loader doesn't. Without it,
+// arenas fall back to a draw call per mesh.
+bool initMultiDraw(GLADloadproc);
+
+// Where a mesh's vertices and indices are in an arena
+struct ArenaRange {
+	unsigned int FirstVertex;
+	unsigned int NumVertices;
+	unsigned int FirstIndex;
+	unsigned int NumIndices;
+};
+
+// RangeAllocator class
+// Hands out ranges of a buffer first-fit from a list of free ranges, merging them back
+// together as they're freed. Doesn't touch gl.
+class RangeAllocator {
+	public:
+		RangeAllocator(unsigned int = 0);
+
+		bool Allocate(unsigned int, unsigned int&);
+		void Free(unsigned int, unsigned int);
+		void Grow(unsigned int);
+
+		unsigned int Capacity() const;
+		unsigned int Used() const;
+
+	private:
+		struct FreeRange {
+			unsigned int Offset;
+			unsigned int Count;
+		};
+
+		unsigned int capacity;
+		unsigned int used;
+		std::vector<FreeRange> freeRanges; // sorted by offset
+};
+
+// GeometryArena class
+// Meshes made in an arena are drawn by queueing them each frame and submitting the whole
+// queue at once. Queued meshes are grouped by texture set, and each group is one
+// glMultiDrawElementsIndirect call where that's supported. Each draw's model matrix is
+// fetched in the shader by its draw id.
+class GeometryArena {
+	public:
+		GeometryArena(unsigned int = ARENA_VERTICES, unsigned int = ARENA_INDICES);
+
+		bool Allocate(const std::vector<Vertex>&, const std::vector<unsigned int>&, ArenaRange&);
+		void Free(const ArenaRange&);
+
+		void Queue(Mesh*, const ArenaRange&, const glm::mat4&);
+		void Submit(Shader&);
+
+		unsigned int GetVAO() const;
+		bool MultiDraw() const;
+		unsigned int NumDraws() const;
+		unsigned int NumCalls() const;
+
+	private:
+		struct QueuedDraw {
+			Mesh *DrawMesh;
+			ArenaRange Range;
+			glm::mat4 Model;
+		};
+
+		// laid out the way glMultiDrawElementsIndirect reads them
+		struct DrawCommand {
+			unsigned int Count;
+			unsigned int InstanceCount;
+			unsigned int FirstIndex;
+			int BaseVertex;
+			unsigned int BaseInstance;
+		};
+
+		RangeAllocator vertexRanges;
+		RangeAllocator indexRanges;
+
+		VertexArrayHandle VAO;
+		BufferHandle VBO, EBO;
+		BufferHandle drawIDs; // just 0, 1, 2, ..., read once per draw
+		BufferHandle commandBuffer;
+		BufferHandle modelBuffer;
+		TextureHandle modelTexture;
+		unsigned int drawIDCapacity;
+
+		std::vector<QueuedDraw> queue;
+		std::vector<DrawCommand> commands;
+		std::vector<glm::mat4> models;
+		unsigned int lastDraws, lastCalls;
+
+		void grow(unsigned int, unsigned int);
+		void setupVertexArray();
+		void reserveDraws(unsigned int);
+};
+
+// ArenaAllocation class
+// Owns a range of an arena, freeing it when it goes away. Moved, never copied, like the
+// gl handles.
+class ArenaAllocation {
+	public:
+		ArenaAllocation();
+		ArenaAllocation(GeometryArena*, const ArenaRange&);
+		~ArenaAllocation();
+
+		ArenaAllocation(ArenaAllocation&&) noexcept;
+		ArenaAllocation& operator=(ArenaAllocation&&) noexcept;
+		ArenaAllocation(const ArenaAllocation&) = delete;
+		ArenaAllocation& operator=(const ArenaAllocation&) = delete;
+
+		GeometryArena* Arena() const;
+		const ArenaRange& Range() const;
+
+	private:
+		GeometryArena *arena;
+		ArenaRange range;
+};
+
+#endif
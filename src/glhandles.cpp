@@ -0,0 +1,99 @@
+// glhandles.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+
+// stdlib
+#include <cstddef> // for size_t
+
+// our files
+#include "glhandles.h" // for GLHandle declaration
+
+// GLHandle Constructor, which owns nothing
+template <GLHandleType Type>
+GLHandle<Type>::GLHandle() : id(0) {
+}
+
+// GLHandle Constructor, which takes ownership of an object that's already been made
+template <GLHandleType Type>
+GLHandle<Type>::GLHandle(unsigned int id) : id(id) {
+}
+
+// GLHandle Destructor
+template <GLHandleType Type>
+GLHandle<Type>::~GLHandle() {
+	Reset();
+}
+
+// GLHandle Move Constructor. The handle moved from is left owning nothing.
+template <GLHandleType Type>
+GLHandle<Type>::GLHandle(GLHandle &&other) noexcept : id(other.id) {
+	other.id = 0;
+}
+
+// GLHandle Move Assignment, deleting whatever this handle owned before
+template <GLHandleType Type>
+GLHandle<Type>& GLHandle<Type>::operator=(GLHandle &&other) noexcept {
+	if (this != &other)
+		Reset(other.Release());
+	return *this;
+}
+
+// Makes a new object of the handle's type
+template <GLHandleType Type>
+GLHandle<Type> GLHandle<Type>::Create() {
+	unsigned int id = 0;
+	switch (Type) {
+		case HANDLE_BUFFER: glGenBuffers(1, &id); break;
+		case HANDLE_VERTEX_ARRAY: glGenVertexArrays(1, &id); break;
+		case HANDLE_TEXTURE: glGenTextures(1, &id); break;
+		case HANDLE_PROGRAM: id = glCreateProgram(); break;
+	}
+	return GLHandle(id);
+}
+
+// Gets the object's ID, or 0 if the handle owns nothing
+template <GLHandleType Type>
+GLHandle<Type>::operator unsigned int() const {
+	return id;
+}
+
+// Gives up ownership of the object without deleting it, returning its ID
+template <GLHandleType Type>
+unsigned int GLHandle<Type>::Release() {
+	unsigned int released = id;
+	id = 0;
+	return released;
+}
+
+// Deletes the object, then takes ownership of the given one (if any)
+template <GLHandleType Type>
+void GLHandle<Type>::Reset(unsigned int newID) {
+	if (id != 0) {
+		switch (Type) {
+			case HANDLE_BUFFER: glDeleteBuffers(1, &id); break;
+			case HANDLE_VERTEX_ARRAY: glDeleteVertexArrays(1, &id); break;
+			case HANDLE_TEXTURE: glDeleteTextures(1, &id); break;
+			case HANDLE_PROGRAM: glDeleteProgram(id); break;
+		}
+	}
+	id = newID;
+}
+
+// instantiating the handles we'll need
+template class GLHandle<HANDLE_BUFFER>;
+template class GLHandle<HANDLE_VERTEX_ARRAY>;
+template class GLHandle<HANDLE_TEXTURE>;
+template class GLHandle<HANDLE_PROGRAM>;
+
+// Refills a buffer that changes every frame. The old storage is orphaned first (capacity
+// bytes of fresh storage are asked for), so the driver can hand back new memory instead of
+// waiting on the gpu to finish drawing from the old contents. Then size bytes of data are
+// copied in. Leaves nothing bound to the target.
+void streamBuffer(GLenum target, unsigned int buffer, size_t capacity, size_t size, const void *data) {
+	glBindBuffer(target, buffer);
+	glBufferData(target, capacity, NULL, GL_STREAM_DRAW);
+	if (size > 0)
+		glBufferSubData(target, 0, size, data);
+	glBindBuffer(target, 0);
+}
@@ -0,0 +1,53 @@
+#ifndef GLHANDLES_H
+#define GLHANDLES_H
+// glhandles.h
+// Defines the GLHandle class, which owns a single gl object and deletes it when it goes
+// away. Handles can be moved but not copied, so each object has exactly one owner. Also
+// has streamBuffer, for refilling buffers that change every frame.
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+
+// stdlib
+#include <cstddef> // for size_t
+
+// the kinds of gl object a handle can own, which decides how it's made and deleted
+enum GLHandleType {
+	HANDLE_BUFFER,
+	HANDLE_VERTEX_ARRAY,
+	HANDLE_TEXTURE,
+	HANDLE_PROGRAM
+};
+
+// GLHandle class
+// Converts to the object's ID, so it can be passed straight to gl calls.
+template <GLHandleType Type>
+class GLHandle {
+	public:
+		GLHandle();
+		explicit GLHandle(unsigned int);
+		~GLHandle();
+
+		GLHandle(GLHandle&&) noexcept;
+		GLHandle& operator=(GLHandle&&) noexcept;
+		GLHandle(const GLHandle&) = delete;
+		GLHandle& operator=(const GLHandle&) = delete;
+
+		static GLHandle Create();
+
+		operator unsigned int() const;
+		unsigned int Release();
+		void Reset(unsigned int = 0);
+
+	private:
+		unsigned int id;
+};
+
+typedef GLHandle<HANDLE_BUFFER> BufferHandle;
+typedef GLHandle<HANDLE_VERTEX_ARRAY> VertexArrayHandle;
+typedef GLHandle<HANDLE_TEXTURE> TextureHandle;
+typedef GLHandle<HANDLE_PROGRAM> ProgramHandle;
+
+void streamBuffer(GLenum, unsigned int, size_t, size_t, const void*);
+
+#endif
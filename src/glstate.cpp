@@ -0,0 +1,113 @@
+// glstate.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+
+// our files
+#include "glstate.h" // for GLStateCache declaration
+
+// GLStateCache Constructor
+GLStateCache::GLStateCache() : changes(0), filtered(0) {
+	Invalidate();
+}
+
+// Forgets everything, so the next change of each kind goes through to gl
+void GLStateCache::Invalidate() {
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (unsigned int i = 0; i < CACHED_TEXTURE_UNITS; ++i) {
+		textures[i] = UNKNOWN;
+		textureTargets[i] = GL_NONE;
+	}
+	blend = UNKNOWN;
+	blendSource = GL_NONE;
+	blendDest = GL_NONE;
+}
+
+// Makes a program current
+void GLStateCache::UseProgram(unsigned int id) {
+	if (change(program != id)) {
+		glUseProgram(id);
+		program = id;
+	}
+}
+
+// Binds a vertex array
+void GLStateCache::BindVertexArray(unsigned int id) {
+	if (change(vertexArray != id)) {
+		glBindVertexArray(id);
+		vertexArray = id;
+	}
+}
+
+// Makes a texture unit active
+void GLStateCache::ActiveTexture(unsigned int unit) {
+	if (change(activeUnit != unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+	}
+}
+
+// Binds a texture to a texture unit, only switching the active unit if it has to
+void GLStateCache::BindTexture(unsigned int unit, GLenum target, unsigned int id) {
+	if (unit >= CACHED_TEXTURE_UNITS) {
+		ActiveTexture(unit);
+		glBindTexture(target, id);
+		++changes;
+		return;
+	}
+
+	if (!change(textures[unit] != id || textureTargets[unit] != target))
+		return;
+
+	ActiveTexture(unit);
+	glBindTexture(target, id);
+	textures[unit] = id;
+	textureTargets[unit] = target;
+}
+
+// Turns blending on or off
+void GLStateCache::SetBlend(bool enabled) {
+	if (change(blend != (unsigned int)enabled)) {
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+		blend = enabled;
+	}
+}
+
+// Sets the blend function
+void GLStateCache::SetBlendFunc(GLenum source, GLenum dest) {
+	if (change(blendSource != source || blendDest != dest)) {
+		glBlendFunc(source, dest);
+		blendSource = source;
+		blendDest = dest;
+	}
+}
+
+// Gets how many state changes went through to gl since the counts were reset
+unsigned int GLStateCache::NumChanges() const {
+	return changes;
+}
+
+// Gets how many state changes were skipped as redundant since the counts were reset
+unsigned int GLStateCache::NumFiltered() const {
+	return filtered;
+}
+
+// Starts counting from zero again
+void GLStateCache::ResetCounts() {
+	changes = 0;
+	filtered = 0;
+}
+
+// Counts a state change as made or filtered. Returns whether it needs making.
+bool GLStateCache::change(bool needed) {
+	if (needed)
+		++changes;
+	else
+		++filtered;
+	return needed;
+}
@@ -0,0 +1,50 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+// glstate.h
+// Defines the GLStateCache class, which remembers what's bound so it can skip gl calls that
+// wouldn't change anything.
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+
+const unsigned int CACHED_TEXTURE_UNITS = 16;
+
+// GLStateCache class
+// Only knows what's gone through it, so anything bound straight through gl in between
+// makes it wrong. It starts out not knowing anything, and should be invalidated whenever
+// other code might have touched the state, like at the start of every frame's submit.
+class GLStateCache {
+	public:
+		GLStateCache();
+
+		void Invalidate();
+
+		void UseProgram(unsigned int);
+		void BindVertexArray(unsigned int);
+		void ActiveTexture(unsigned int);
+		void BindTexture(unsigned int, GLenum, unsigned int);
+		void SetBlend(bool);
+		void SetBlendFunc(GLenum, GLenum);
+
+		unsigned int NumChanges() const;
+		unsigned int NumFiltered() const;
+		void ResetCounts();
+
+	private:
+		// UNKNOWN where it's not known what's bound
+		static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+		unsigned int program;
+		unsigned int vertexArray;
+		unsigned int activeUnit;
+		unsigned int textures[CACHED_TEXTURE_UNITS];
+		GLenum textureTargets[CACHED_TEXTURE_UNITS];
+		unsigned int blend; // 0, 1, or UNKNOWN
+		GLenum blendSource, blendDest;
+
+		unsigned int changes, filtered;
+
+		bool change(bool);
+};
+
+#endif
@@ -5,11 +5,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-// stdlib
-#include <string> // for string, to_string
-
 // our files
-#include "shader.h" // for Shader class
 #include "light.h" // for Light declaration
 
 // Point Light Constructor
@@ -25,35 +21,19 @@ PointLight::PointLight(glm::vec3 position, glm::vec3 ambient, glm::vec3 diffuse,
 	IsOn = isOn;
 }
 
-// Adds Light to Shader, in an array of Lights
-void PointLight::AddLight(Shader &shader, int index_int, std::string uniformName) 
+// Gets the Light as it's laid out in the Lights block
+PointLightData PointLight::ToData() const
 {
-	std::string index = std::to_string(index_int);
-	shader.use();
-
-	shader.setVec3(uniformName + "[" + index + "].position", Position);
-	shader.setVec3(uniformName + "[" + index + "].ambient", Ambient);
-	shader.setVec3(uniformName + "[" + index + "].diffuse", Diffuse);
-	shader.setVec3(uniformName + "[" + index + "].specular", Specular);
-	shader.setFloat(uniformName + "[" + index + "].constant", Constant);
-	shader.setFloat(uniformName + "[" + index + "].linear", Linear);
-	shader.setFloat(uniformName + "[" + index + "].quadratic", Quadratic);
-	shader.setBool(uniformName + "[" + index + "].isOn", IsOn);
-}
-
-// Adds Light to Shader, not in an array of Lights
-void PointLight::AddLight(Shader &shader, std::string uniformName) 
-{
-	shader.use();
-
-	shader.setVec3(uniformName + ".position", Position);
-	shader.setVec3(uniformName + ".ambient", Ambient);
-	shader.setVec3(uniformName + ".diffuse", Diffuse);
-	shader.setVec3(uniformName + ".specular", Specular);
-	shader.setFloat(uniformName + ".constant", Constant);
-	shader.setFloat(uniformName + ".linear", Linear);
-	shader.setFloat(uniformName + ".quadratic", Quadratic);
-	shader.setBool(uniformName + ".isOn", IsOn);
+	PointLightData data;
+	data.Position = Position;
+	data.Constant = Constant;
+	data.Ambient = Ambient;
+	data.Linear = Linear;
+	data.Diffuse = Diffuse;
+	data.Quadratic = Quadratic;
+	data.Specular = Specular;
+	data.IsOn = IsOn;
+	return data;
 }
 
 // Directional Light Constructor
@@ -66,29 +46,16 @@ DirectionalLight::DirectionalLight(glm::vec3 direction, glm::vec3 ambient, glm::
 	IsOn = isOn;
 }
 
-// Adds Light to Shader, in an array of Lights
-void DirectionalLight::AddLight(Shader &shader, int index_int, std::string uniformName) 
+// Gets the Light as it's laid out in the Lights block
+DirectionalLightData DirectionalLight::ToData() const
 {
-	std::string index = std::to_string(index_int);
-	shader.use();
-
-	shader.setVec3(uniformName + "[" + index + "].direction", Direction);
-	shader.setVec3(uniformName + "[" + index + "].ambient", Ambient);
-	shader.setVec3(uniformName + "[" + index + "].diffuse", Diffuse);
-	shader.setVec3(uniformName + "[" + index + "].specular", Specular);
-	shader.setBool(uniformName + "[" + index + "].isOn", IsOn);
-}
-
-// Adds Light to Shader, not in an array of Lights
-void DirectionalLight::AddLight(Shader &shader, std::string uniformName) 
-{
-	shader.use();
-
-	shader.setVec3(uniformName + ".direction", Direction);
-	shader.setVec3(uniformName + ".ambient", Ambient);
-	shader.setVec3(uniformName + ".diffuse", Diffuse);
-	shader.setVec3(uniformName + ".specular", Specular);
-	shader.setBool(uniformName + ".isOn", IsOn);
+	DirectionalLightData data = {};
+	data.Direction = Direction;
+	data.IsOn = IsOn;
+	data.Ambient = Ambient;
+	data.Diffuse = Diffuse;
+	data.Specular = Specular;
+	return data;
 }
 
 // SpotLight Constructor
@@ -107,40 +74,20 @@ SpotLight::SpotLight(glm::vec3 position, glm::vec3 direction, float cutOff, floa
 	IsOn = isOn;
 }
 
-// Adds Light to Shader, in an array of Lights
-void SpotLight::AddLight(Shader &shader, int index_int, std::string uniformName) 
-{
-	std::string index = std::to_string(index_int);
-	shader.use();
-
-	shader.setVec3(uniformName + "[" + index + "].position", Position);
-	shader.setVec3(uniformName + "[" + index + "].direction", Direction);
-	shader.setFloat(uniformName + "[" + index + "].cutOff", CutOff);
-	shader.setFloat(uniformName + "[" + index + "].outerCutOff", OuterCutOff);
-	shader.setVec3(uniformName + "[" + index + "].ambient", Ambient);
-	shader.setVec3(uniformName + "[" + index + "].diffuse", Diffuse);
-	shader.setVec3(uniformName + "[" + index + "].specular", Specular);
-	shader.setFloat(uniformName + "[" + index + "].constant", Constant);
-	shader.setFloat(uniformName + "[" + index + "].linear", Linear);
-	shader.setFloat(uniformName + "[" + index + "].quadratic", Quadratic);
-	shader.setBool(uniformName + "[" + index + "].isOn", IsOn);
-}
-
-// Adds Light to Shader, not in an array of Lights
-
-void SpotLight::AddLight(Shader &shader, std::string uniformName) 
+// Gets the Light as it's laid out in the Lights block
+SpotLightData SpotLight::ToData() const
 {
-	shader.use();
-
-	shader.setVec3(uniformName + ".position", Position);
-	shader.setVec3(uniformName + ".direction", Direction);
-	shader.setFloat(uniformName + ".cutOff", CutOff);
-	shader.setFloat(uniformName + ".outerCutOff", OuterCutOff);
-	shader.setVec3(uniformName + ".ambient", Ambient);
-	shader.setVec3(uniformName + ".diffuse", Diffuse);
-	shader.setVec3(uniformName + ".specular", Specular);
-	shader.setFloat(uniformName + ".constant", Constant);
-	shader.setFloat(uniformName + ".linear", Linear);
-	shader.setFloat(uniformName + ".quadratic", Quadratic);
-	shader.setBool(uniformName + ".isOn", IsOn);
+	SpotLightData data = {};
+	data.Position = Position;
+	data.CutOff = CutOff;
+	data.Direction = Direction;
+	data.OuterCutOff = OuterCutOff;
+	data.Ambient = Ambient;
+	data.Constant = Constant;
+	data.Diffuse = Diffuse;
+	data.Linear = Linear;
+	data.Specular = Specular;
+	data.Quadratic = Quadratic;
+	data.IsOn = IsOn;
+	return data;
 }
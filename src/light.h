@@ -6,12 +6,6 @@
 #include <glm/glm.hpp> // gl maths
 #include <glm/gtc/type_ptr.hpp>
 
-// stdlib
-#include <string> // for string, to_string
-
-// our files
-#include "shader.h" // for shader class
-
 const glm::vec3 POSITION = glm::vec3(0.0f);
 const glm::vec3 LIGHTDIRECTION = glm::vec3(0.0f, -1.0f, 0.0f);
 
@@ -28,6 +22,44 @@ const float QUADRATIC = 0.032f;
 
 const bool ISON = true;
 
+// how many directional lights the Lights block in object.frag holds. Point lights and
+// spotlights go through the light clusters instead (see lightclusters.h).
+const unsigned int MAX_DIR_LIGHTS = 20;
+
+// Each light as it's laid out (std140) in the Lights block, or in the cluster buffers. Every
+// vec3 is followed by a scalar, which std140 packs into the same 16 bytes.
+struct PointLightData
+{
+	glm::vec3 Position; float Constant;
+	glm::vec3 Ambient; float Linear;
+	glm::vec3 Diffuse; float Quadratic;
+	glm::vec3 Specular; int IsOn;
+};
+
+struct DirectionalLightData
+{
+	glm::vec3 Direction; int IsOn;
+	glm::vec3 Ambient; float pad0;
+	glm::vec3 Diffuse; float pad1;
+	glm::vec3 Specular; float pad2;
+};
+
+struct SpotLightData
+{
+	glm::vec3 Position; float CutOff;
+	glm::vec3 Direction; float OuterCutOff;
+	glm::vec3 Ambient; float Constant;
+	glm::vec3 Diffuse; float Linear;
+	glm::vec3 Specular; float Quadratic;
+	int IsOn; float pad[3];
+};
+
+// The whole Lights block. Unused slots are left zeroed, which is off.
+struct LightsData
+{
+	DirectionalLightData DirLights[MAX_DIR_LIGHTS];
+};
+
 class PointLight
 {
 	public:
@@ -45,8 +77,7 @@ class PointLight
 
 		PointLight(glm::vec3 = POSITION, glm::vec3 = AMBIENT, glm::vec3 = DIFFUSE, glm::vec3 = SPECULAR, float = CONSTANT, float = LINEAR, float = QUADRATIC, bool = ISON);
 
-    void AddLight(Shader&, int, std::string); 
-    void AddLight(Shader&, std::string); 
+    PointLightData ToData() const;
 };
 
 class DirectionalLight
@@ -62,8 +93,7 @@ class DirectionalLight
 
 		DirectionalLight(glm::vec3 = LIGHTDIRECTION, glm::vec3 = AMBIENT, glm::vec3 = DIFFUSE, glm::vec3 = SPECULAR, bool = ISON);
 		
-    void AddLight(Shader&, int, std::string); 
-    void AddLight(Shader&, std::string);
+    DirectionalLightData ToData() const;
 };
 
 class SpotLight
@@ -87,8 +117,7 @@ class SpotLight
 
 		SpotLight(glm::vec3 = POSITION, glm::vec3 = LIGHTDIRECTION, float = CUTOFF, float = OUTERCUTOFF, glm::vec3 = AMBIENT, glm::vec3 = DIFFUSE, glm::vec3 = SPECULAR, float = CONSTANT, float = LINEAR, float = QUADRATIC, bool = ISON);
 	 
-    void AddLight(Shader&, int, std::string);
-    void AddLight(Shader&, std::string); 
+    SpotLightData ToData() const;
 };
 
 #endif
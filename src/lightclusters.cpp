@@ -0,0 +1,276 @@
+// lightclusters.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <cmath> // for tan, pow, log, sqrt
+#include <cfloat> // for FLT_MAX
+#include <algorithm> // for min, max
+using namespace std;
+
+// our files
+#include "lightclusters.h" // for LightClusters declaration
+#include "light.h" // for PointLight, SpotLight classes
+#include "shader.h" // for Shader class
+#include "glhandles.h" // for streamBuffer
+
+// marks a light index in the scratch pairs as a spotlight rather than a point light
+static const unsigned int SPOT_BIT = 1u << 31;
+
+// the sampler uniforms in object.frag, in the order the buffers are bound
+static const char* const SAMPLER_NAMES[] = {"clusterPointLights", "clusterSpotLights", "clusterRanges", "clusterLightIndices"};
+
+// LightClusters Constructor
+LightClusters::LightClusters(unsigned int maxPointLights, unsigned int maxSpotLights) : maxPointLights(maxPointLights), maxSpotLights(maxSpotLights), fovY(0.0f), aspect(0.0f), nearPlane(0.0f), farPlane(0.0f), mostLights(0), glReady(false) {
+	clusterMin.resize(NUM_CLUSTERS);
+	clusterMax.resize(NUM_CLUSTERS);
+	clusters.resize(NUM_CLUSTERS);
+	pointCounts.resize(NUM_CLUSTERS);
+	spotCounts.resize(NUM_CLUSTERS);
+	pointLights.reserve(maxPointLights);
+	spotLights.reserve(maxSpotLights);
+	lightIndices.reserve(MAX_LIGHT_INDICES);
+}
+
+// Sets the projection the clusters are cut from (vertical fov in radians, aspect ratio,
+// near and far planes), working out the bounds of every cluster in view space. Does
+// nothing if the projection hasn't changed.
+void LightClusters::SetProjection(float newFovY, float newAspect, float newNear, float newFar) {
+	if (newFovY == fovY && newAspect == aspect && newNear == nearPlane && newFar == farPlane)
+		return;
+	fovY = newFovY;
+	aspect = newAspect;
+	nearPlane = newNear;
+	farPlane = newFar;
+
+	float tanY = tan(fovY / 2.0f);
+	float tanX = tanY * aspect;
+	for (unsigned int k = 0; k < CLUSTERS_Z; ++k) {
+		float zNear = nearPlane * pow(farPlane / nearPlane, (float)k / CLUSTERS_Z);
+		float zFar = nearPlane * pow(farPlane / nearPlane, (float)(k + 1) / CLUSTERS_Z);
+
+		for (unsigned int j = 0; j < CLUSTERS_Y; ++j) {
+			float y0 = -1.0f + 2.0f * j / CLUSTERS_Y;
+			float y1 = -1.0f + 2.0f * (j + 1) / CLUSTERS_Y;
+
+			for (unsigned int i = 0; i < CLUSTERS_X; ++i) {
+				float x0 = -1.0f + 2.0f * i / CLUSTERS_X;
+				float x1 = -1.0f + 2.0f * (i + 1) / CLUSTERS_X;
+
+				// the cluster is a chunk of frustum, so its box has to cover the tile's
+				// corners at both its near and far depths
+				unsigned int c = i + CLUSTERS_X * (j + CLUSTERS_Y * k);
+				clusterMin[c] = glm::vec3(min(x0 * zNear, x0 * zFar) * tanX, min(y0 * zNear, y0 * zFar) * tanY, -zFar);
+				clusterMax[c] = glm::vec3(max(x1 * zNear, x1 * zFar) * tanX, max(y1 * zNear, y1 * zFar) * tanY, -zNear);
+			}
+		}
+	}
+}
+
+// Assigns this frame's lights to the clusters they can reach, given the camera's view
+// matrix. Lights that are off are left out, and anything past the maximums is dropped.
+void LightClusters::Build(const glm::mat4 &view, const vector<PointLight> &points, const vector<SpotLight> &spots) {
+	pointLights.clear();
+	spotLights.clear();
+	pairCluster.clear();
+	pairLight.clear();
+
+	for (unsigned int i = 0; i < points.size() && pointLights.size() < maxPointLights; ++i) {
+		const PointLight &light = points[i];
+		if (!light.IsOn)
+			continue;
+
+		float range = LightRange(light.Ambient, light.Diffuse, light.Specular, light.Constant, light.Linear, light.Quadratic);
+		assignLight(glm::vec3(view * glm::vec4(light.Position, 1.0f)), range, pointLights.size());
+		pointLights.push_back(light.ToData());
+	}
+
+	// spotlights are treated as spheres too, which is loose for narrow cones but cheap
+	for (unsigned int i = 0; i < spots.size() && spotLights.size() < maxSpotLights; ++i) {
+		const SpotLight &light = spots[i];
+		if (!light.IsOn)
+			continue;
+
+		float range = LightRange(light.Ambient, light.Diffuse, light.Specular, light.Constant, light.Linear, light.Quadratic);
+		assignLight(glm::vec3(view * glm::vec4(light.Position, 1.0f)), range, spotLights.size() | SPOT_BIT);
+		spotLights.push_back(light.ToData());
+	}
+
+	// counting how many lights each cluster got, so each can have a contiguous range
+	fill(pointCounts.begin(), pointCounts.end(), 0);
+	fill(spotCounts.begin(), spotCounts.end(), 0);
+	for (unsigned int i = 0; i < pairCluster.size(); ++i) {
+		if (pairLight[i] & SPOT_BIT)
+			++spotCounts[pairCluster[i]];
+		else
+			++pointCounts[pairCluster[i]];
+	}
+
+	unsigned int total = 0;
+	mostLights = 0;
+	for (unsigned int c = 0; c < NUM_CLUSTERS; ++c) {
+		ClusterRange &range = clusters[c];
+		range.PointOffset = total;
+		range.PointCount = min(pointCounts[c], MAX_LIGHT_INDICES - total);
+		total += range.PointCount;
+		range.SpotOffset = total;
+		range.SpotCount = min(spotCounts[c], MAX_LIGHT_INDICES - total);
+		total += range.SpotCount;
+		mostLights = max(mostLights, range.PointCount + range.SpotCount);
+	}
+
+	// then filling the ranges in, reusing the counts as how far along each one is
+	lightIndices.resize(total);
+	fill(pointCounts.begin(), pointCounts.end(), 0);
+	fill(spotCounts.begin(), spotCounts.end(), 0);
+	for (unsigned int i = 0; i < pairCluster.size(); ++i) {
+		unsigned int c = pairCluster[i];
+		const ClusterRange &range = clusters[c];
+		if (pairLight[i] & SPOT_BIT) {
+			if (spotCounts[c] < range.SpotCount)
+				lightIndices[range.SpotOffset + spotCounts[c]++] = pairLight[i] & ~SPOT_BIT;
+		}
+		else {
+			if (pointCounts[c] < range.PointCount)
+				lightIndices[range.PointOffset + pointCounts[c]++] = pairLight[i];
+		}
+	}
+}
+
+// Adds a light (as a sphere in view space) to every cluster it touches
+void LightClusters::assignLight(const glm::vec3 &centre, float range, unsigned int light) {
+	float depth = -centre.z;
+	if (depth + range < nearPlane || depth - range > farPlane)
+		return;
+
+	unsigned int firstSlice = depthSlice(depth - range);
+	unsigned int lastSlice = depthSlice(depth + range);
+	float rangeSq = range * range;
+
+	for (unsigned int k = firstSlice; k <= lastSlice; ++k) {
+		for (unsigned int j = 0; j < CLUSTERS_Y; ++j) {
+			// every cluster in a row shares its y and z bounds, so we can skip whole rows
+			unsigned int row = CLUSTERS_X * (j + CLUSTERS_Y * k);
+			float dy = max(max(clusterMin[row].y - centre.y, centre.y - clusterMax[row].y), 0.0f);
+			float dz = max(max(clusterMin[row].z - centre.z, centre.z - clusterMax[row].z), 0.0f);
+			float rowDistSq = dy * dy + dz * dz;
+			if (rowDistSq > rangeSq)
+				continue;
+
+			for (unsigned int i = 0; i < CLUSTERS_X; ++i) {
+				unsigned int c = row + i;
+				float dx = max(max(clusterMin[c].x - centre.x, centre.x - clusterMax[c].x), 0.0f);
+				if (rowDistSq + dx * dx > rangeSq)
+					continue;
+
+				pairCluster.push_back(c);
+				pairLight.push_back(light);
+			}
+		}
+	}
+}
+
+// Gets which depth slice a view space depth falls in
+unsigned int LightClusters::depthSlice(float depth) const {
+	if (depth <= nearPlane)
+		return 0;
+	if (depth >= farPlane)
+		return CLUSTERS_Z - 1;
+	unsigned int slice = (unsigned int)(log(depth / nearPlane) / log(farPlane / nearPlane) * CLUSTERS_Z);
+	return min(slice, CLUSTERS_Z - 1);
+}
+
+// Gets how far a light reaches before its brightest channel falls under LIGHT_CUTOFF
+float LightClusters::LightRange(const glm::vec3 &ambient, const glm::vec3 &diffuse, const glm::vec3 &specular, float constant, float linear, float quadratic) {
+	glm::vec3 total = ambient + diffuse + specular;
+	float brightest = max(total.x, max(total.y, total.z));
+
+	// solving constant + linear * d + quadratic * d^2 = brightest / cutoff
+	float target = brightest / LIGHT_CUTOFF - constant;
+	if (target <= 0.0f)
+		return 0.0f;
+	if (quadratic > 0.0f)
+		return (-linear + sqrt(linear * linear + 4.0f * quadratic * target)) / (2.0f * quadratic);
+	if (linear > 0.0f)
+		return target / linear;
+	return FLT_MAX;
+}
+
+// Uploads this frame's lights, ranges and indices to the gpu
+void LightClusters::Upload() {
+	if (!glReady)
+		setupGL();
+
+	streamBuffer(GL_TEXTURE_BUFFER, buffers[0], maxPointLights * sizeof(PointLightData), pointLights.size() * sizeof(PointLightData), pointLights.data());
+	streamBuffer(GL_TEXTURE_BUFFER, buffers[1], maxSpotLights * sizeof(SpotLightData), spotLights.size() * sizeof(SpotLightData), spotLights.data());
+	streamBuffer(GL_TEXTURE_BUFFER, buffers[2], NUM_CLUSTERS * sizeof(ClusterRange), NUM_CLUSTERS * sizeof(ClusterRange), clusters.data());
+	streamBuffer(GL_TEXTURE_BUFFER, buffers[3], MAX_LIGHT_INDICES * sizeof(unsigned int), lightIndices.size() * sizeof(unsigned int), lightIndices.data());
+}
+
+// Binds the buffers to their texture units
+void LightClusters::Bind() const {
+	for (unsigned int i = 0; i < 4; ++i) {
+		glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// Points a shader's cluster samplers at the units the buffers are bound to
+void LightClusters::SetSamplers(Shader &shader) const {
+	shader.use();
+	for (unsigned int i = 0; i < 4; ++i) {
+		shader.setInt(SAMPLER_NAMES[i], CLUSTER_TEXTURE_UNIT + i);
+	}
+}
+
+// Makes the buffers, and the buffer textures the shader reads them through. The lights
+// are read four floats at a time, so their std140 structs work as they are.
+void LightClusters::setupGL() {
+	const GLenum formats[] = {GL_RGBA32F, GL_RGBA32F, GL_RGBA32UI, GL_R32UI};
+
+	for (unsigned int i = 0; i < 4; ++i) {
+		buffers[i] = BufferHandle::Create();
+		textures[i] = TextureHandle::Create();
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glReady = true;
+}
+
+// Gets the range of lights in a cluster
+const ClusterRange& LightClusters::GetCluster(unsigned int x, unsigned int y, unsigned int z) const {
+	return clusters[x + CLUSTERS_X * (y + CLUSTERS_Y * z)];
+}
+
+// Gets an entry of the light index list that the cluster ranges point into
+unsigned int LightClusters::GetLightIndex(unsigned int i) const {
+	return lightIndices[i];
+}
+
+// Gets the number of point lights that were on this frame
+unsigned int LightClusters::NumPointLights() const {
+	return pointLights.size();
+}
+
+// Gets the number of spotlights that were on this frame
+unsigned int LightClusters::NumSpotLights() const {
+	return spotLights.size();
+}
+
+// Gets the length of the light index list
+unsigned int LightClusters::NumLightIndices() const {
+	return lightIndices.size();
+}
+
+// Gets the most lights any one cluster has to deal with
+unsigned int LightClusters::MostLightsInCluster() const {
+	return mostLights;
+}
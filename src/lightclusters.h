@@ -0,0 +1,95 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+// lightclusters.h
+// Defines the LightClusters class, which splits the view frustum into a grid of clusters
+// and works out which point lights and spotlights can reach each one, so that each
+// fragment only has to light itself with the few lights in its cluster.
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+
+// our files
+#include "light.h" // for PointLight, SpotLight classes
+#include "shader.h" // for Shader class
+#include "glhandles.h" // for BufferHandle, TextureHandle
+
+// the cluster grid, which is tiled evenly across the screen and sliced exponentially in
+// depth. These have to match the defines in object.frag.
+const unsigned int CLUSTERS_X = 16;
+const unsigned int CLUSTERS_Y = 9;
+const unsigned int CLUSTERS_Z = 24;
+const unsigned int NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+const unsigned int MAX_CLUSTERED_POINT_LIGHTS = 512;
+const unsigned int MAX_CLUSTERED_SPOT_LIGHTS = 512;
+const unsigned int MAX_LIGHT_INDICES = 65536; // the smallest texture buffer gl has to allow
+const float LIGHT_CUTOFF = 1.0f / 256.0f; // how dim a light has to get before it stops reaching
+const unsigned int CLUSTER_TEXTURE_UNIT = 8; // the first of the four units the buffers are bound to
+
+// Where a cluster's lights are in the index list. Its point lights come first, then its
+// spotlights straight after.
+struct ClusterRange
+{
+	unsigned int PointOffset;
+	unsigned int PointCount;
+	unsigned int SpotOffset;
+	unsigned int SpotCount;
+};
+
+// LightClusters class
+// The lights are assigned on the cpu every frame, then handed to object.frag as texture
+// buffers: the lights themselves, a range per cluster, and the list of light indices the
+// ranges point into. Assigning doesn't touch gl, so it can be done without a context.
+class LightClusters {
+	public:
+		LightClusters(unsigned int = MAX_CLUSTERED_POINT_LIGHTS, unsigned int = MAX_CLUSTERED_SPOT_LIGHTS);
+
+		void SetProjection(float, float, float, float);
+		void Build(const glm::mat4&, const std::vector<PointLight>&, const std::vector<SpotLight>&);
+		void Upload();
+		void Bind() const;
+		void SetSamplers(Shader&) const;
+
+		const ClusterRange& GetCluster(unsigned int, unsigned int, unsigned int) const;
+		unsigned int GetLightIndex(unsigned int) const;
+		unsigned int NumPointLights() const;
+		unsigned int NumSpotLights() const;
+		unsigned int NumLightIndices() const;
+		unsigned int MostLightsInCluster() const;
+
+		static float LightRange(const glm::vec3&, const glm::vec3&, const glm::vec3&, float, float, float);
+
+	private:
+		unsigned int maxPointLights;
+		unsigned int maxSpotLights;
+
+		// the projection the clusters were made for, and each cluster's bounds in view space
+		float fovY, aspect, nearPlane, farPlane;
+		std::vector<glm::vec3> clusterMin, clusterMax;
+
+		// this frame's lights (only the ones that are on), and where they landed
+		std::vector<PointLightData> pointLights;
+		std::vector<SpotLightData> spotLights;
+		std::vector<ClusterRange> clusters;
+		std::vector<unsigned int> lightIndices;
+		unsigned int mostLights;
+
+		// scratch space for building, kept around so frames don't allocate
+		std::vector<unsigned int> pairCluster, pairLight;
+		std::vector<unsigned int> pointCounts, spotCounts;
+
+		// the buffers are only made the first time they're uploaded
+		bool glReady;
+		BufferHandle buffers[4];
+		TextureHandle textures[4];
+
+		void assignLight(const glm::vec3&, float, unsigned int);
+		unsigned int depthSlice(float) const;
+		void setupGL();
+};
+
+#endif
@@ -4,52 +4,343 @@
 #include <glm/glm.hpp> // gl maths
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/packing.hpp> // for packHalf2x16, packSnorm2x16
 
 // stdlib
 #include <iostream> // for cin, cout, endl
 #include <string> // for string
 #include <vector> // for vector
+#include <utility> // for move
+#include <map> // for map
+#include <cmath> // for abs, round
 
 // our headers
 #include "shader.h" // for Shader class
 #include "mesh.h" // for Mesh declaration
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle
+#include "geometryarena.h" // for GeometryArena, ArenaAllocation classes
+#include "frustum.h" // for Bounds struct
+#include "occlusion.h" // for OcclusionBuffer class
+#include "glstate.h" // for GLStateCache class
 
-// Mesh Constructor
-Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<Texture>& textures)
+// Gets the id for a set of textures, the same for every Mesh that uses exactly them
+static unsigned int findMaterialID(const std::vector<Texture> &textures)
 {
-	this->vertices = vertices;
-	this->indices = indices;
-	this->textures = textures;
+	static std::map<std::vector<unsigned int>, unsigned int> materials;
 
-	SetupMesh();
+	std::vector<unsigned int> ids;
+	for (unsigned int i = 0; i < textures.size(); ++i)
+	{
+		ids.push_back(textures[i].id);
+	}
+	std::map<std::vector<unsigned int>, unsigned int>::iterator found = materials.find(ids);
+	if (found != materials.end())
+		return found->second;
+
+	unsigned int id = materials.size();
+	materials[ids] = id;
+	return id;
 }
-// Copy Constructor
-Mesh::Mesh(const Mesh& mesh)
+
+// Folds a unit vector onto an octahedron and flattens it out into a square, so it only
+// takes two numbers (-1 to 1) to store
+static glm::vec2 octahedralEncode(glm::vec3 n)
 {
-	vertices = mesh.vertices;
-	indices = mesh.indices;
-	textures = mesh.textures;
+	float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (sum == 0.0f)
+		return glm::vec2(0.0f);
+	n /= sum;
 
-	SetupMesh();
+	// the bottom half's folded out over the corners
+	if (n.z < 0.0f)
+		return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+	return glm::vec2(n.x, n.y);
 }
-// Mesh Destructor
-Mesh::~Mesh()
+
+// Packs vertices down to PackedVertex, with positions stored as how far across the
+// bounds they are
+static std::vector<PackedVertex> packVertices(const std::vector<Vertex> &vertices, const Bounds &bounds)
 {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	glm::vec3 extent = bounds.Max - bounds.Min;
+	std::vector<PackedVertex> packed(vertices.size());
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		for (unsigned int axis = 0; axis < 3; ++axis)
+		{
+			float across = (extent[axis] > 0.0f) ? (vertices[i].Position[axis] - bounds.Min[axis]) / extent[axis] : 0.0f;
+			packed[i].Position[axis] = (unsigned short)std::round(across * 65535.0f);
+		}
+		packed[i].Position[3] = 0;
+		packed[i].Normal = glm::packSnorm2x16(octahedralEncode(vertices[i].Normal));
+		packed[i].TexCoords = glm::packHalf2x16(vertices[i].TexCoords);
+	}
+	return packed;
+}
+
+// Mesh Constructor. Pass the data in with std::move to save copying it. Given an arena,
+// the Mesh is uploaded into that instead of its own buffers. The format's only used for
+// Meshes with their own buffers, since arenas all use Vertex.
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, GeometryArena *arena, VertexFormat format) : indexType(GL_UNSIGNED_INT), format(format), gpuBytes(0)
+{
+	this->vertices = std::move(vertices);
+	this->indices = std::move(indices);
+	this->textures = std::move(textures);
+	indexCount = this->indices.size();
+	samplerShader = 0;
+	positionMinUniform = -1;
+	positionExtentUniform = -1;
+	occluder = false;
+	materialID = findMaterialID(this->textures);
+
+	unsigned int diffuseNr = 0;
+	unsigned int specularNr = 0;
+	for (unsigned int i = 0; i < this->textures.size(); ++i)
+	{
+		if (this->textures[i].type == "texture_specular")
+			textureUnits.push_back(SPECULAR_TEXTURE_UNIT + specularNr++);
+		else
+			textureUnits.push_back(DIFFUSE_TEXTURE_UNIT + diffuseNr++);
+	}
+
+	std::vector<glm::vec3> points(this->vertices.size());
+	for (unsigned int i = 0; i < points.size(); ++i)
+	{
+		points[i] = this->vertices[i].Position;
+	}
+	bounds = boundsOfPoints(points.data(), points.size());
+
+	SetupMesh(arena);
 }
 
 // Draws the Mesh given a Shader
 void Mesh::Draw(Shader& shader)
+{
+	BindTextures(shader);
+	SetUnpacking(shader);
+
+	// now drawing the mesh
+	glBindVertexArray(GetVAO());
+	DrawElements();
+	glBindVertexArray(0);
+}
+
+// Just issues the Mesh's draw call, for when its vertex array and textures are already
+// bound. Given a number of instances, draws it instanced (which arena meshes can't be).
+void Mesh::DrawElements(unsigned int instances)
+{
+	GeometryArena *arena = arenaAllocation.Arena();
+	if (arena != NULL)
+	{
+		const ArenaRange &range = arenaAllocation.Range();
+		if (instances == 0)
+			glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(range.FirstIndex * sizeof(unsigned int)), range.FirstVertex);
+	}
+	else if (instances == 0)
+	{
+		glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+	}
+	else
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, instances);
+	}
+}
+
+// Draws count copies of the Mesh, each with its own model matrix from the instance buffer
+// attached with AttachInstances. Meshes in an arena share its vertex array, so they can't
+// be instanced this way.
+void Mesh::DrawInstanced(Shader& shader, unsigned int count)
+{
+	if (arenaAllocation.Arena() != NULL)
+		return;
+
+	BindTextures(shader);
+	SetUnpacking(shader);
+	glBindVertexArray(VAO);
+	DrawElements(count);
+	glBindVertexArray(0);
+}
+
+// Points the Mesh's instance attributes (a mat4, as four vec4s from location 4) at a buffer
+// of model matrices
+void Mesh::AttachInstances(unsigned int buffer)
+{
+	if (arenaAllocation.Arena() != NULL)
+		return;
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		glEnableVertexAttribArray(INSTANCE_ATTRIB + i);
+		glVertexAttribPointer(INSTANCE_ATTRIB + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(INSTANCE_ATTRIB + i, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Queues the Mesh in its arena, to be drawn with the given model matrix when the arena's
+// submitted. Returns false if the Mesh isn't in an arena.
+bool Mesh::Queue(const glm::mat4 &model)
+{
+	GeometryArena *arena = arenaAllocation.Arena();
+	if (arena == NULL)
+		return false;
+	arena->Queue(this, arenaAllocation.Range(), model);
+	return true;
+}
+
+// Binds the Mesh's textures, pointing the shader's samplers at them first if it's a
+// different shader than last time. The shader has to be in use.
+void Mesh::BindTextures(Shader& shader)
+{
+	if (shader.ID != samplerShader)
+		findSamplers(shader);
+
+	for (unsigned int i = 0; i < textures.size(); ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnits[i]);
+		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// Binds the Mesh's textures through a state cache, which skips any that are already bound
+void Mesh::BindTextures(Shader& shader, GLStateCache& state)
+{
+	if (shader.ID != samplerShader)
+		findSamplers(shader);
+
+	for (unsigned int i = 0; i < textures.size(); ++i)
+	{
+		state.BindTexture(textureUnits[i], GL_TEXTURE_2D, textures[i].id);
+	}
+}
+
+// Gives a packed Mesh's bounds to the shader, which its positions are unpacked across.
+// The shader has to be in use.
+void Mesh::SetUnpacking(Shader& shader)
+{
+	if (format != PACKED_VERTICES)
+		return;
+	if (shader.ID != samplerShader)
+		findSamplers(shader);
+
+	shader.setVec3(positionMinUniform, bounds.Min);
+	shader.setVec3(positionExtentUniform, bounds.Max - bounds.Min);
+}
+
+// Gets the vertex array the Mesh is drawn through, which is its arena's if it has one
+unsigned int Mesh::GetVAO() const
+{
+	GeometryArena *arena = arenaAllocation.Arena();
+	return (arena != NULL) ? arena->GetVAO() : (unsigned int)VAO;
+}
+
+// Gets the id of the Mesh's set of textures, which every Mesh with the same ones shares
+unsigned int Mesh::GetMaterialID() const
+{
+	return materialID;
+}
+
+// Drops the cpu copy of the vertex data that the policy doesn't keep, now that it's on the
+// gpu. Returns how many bytes were freed.
+size_t Mesh::ReleaseVertices(VertexResidency residency)
+{
+	if (residency == KEEP_VERTICES || vertices.capacity() == 0)
+		return 0;
+
+	size_t before = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+
+	if (residency == KEEP_POSITIONS)
+	{
+		positions.resize(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); ++i)
+		{
+			positions[i] = vertices[i].Position;
+		}
+		indices.shrink_to_fit();
+	}
+	else
+	{
+		std::vector<unsigned int>().swap(indices);
+	}
+	std::vector<Vertex>().swap(vertices);
+
+	size_t after = positions.capacity() * sizeof(glm::vec3) + indices.capacity() * sizeof(unsigned int);
+	return before - after;
+}
+
+// Gets a vertex's position, from whichever copy of the vertex data the Mesh still has
+glm::vec3 Mesh::GetPosition(unsigned int index) const
+{
+	if (index < vertices.size())
+		return vertices[index].Position;
+	return positions[index];
+}
+
+// Gets the box and sphere around the Mesh, in model space
+const Bounds& Mesh::GetBounds() const
+{
+	return bounds;
+}
+
+// Makes the Mesh an occluder, which hides things behind it in occlusion buffers. Needs
+// its positions and indices, so returns false if they've been released.
+bool Mesh::MakeOccluder()
+{
+	if (indices.empty())
+		return false;
+
+	// occluders always keep a separate copy of their positions, to rasterize straight from
+	if (positions.empty())
+	{
+		positions.resize(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); ++i)
+		{
+			positions[i] = vertices[i].Position;
+		}
+	}
+	occluder = true;
+	return true;
+}
+
+// Checks whether the Mesh is an occluder
+bool Mesh::IsOccluder() const
+{
+	return occluder;
+}
+
+// Rasterizes the Mesh into an occlusion buffer with the given model matrix, if it's an
+// occluder
+void Mesh::AddOccluder(OcclusionBuffer &buffer, const glm::mat4 &model) const
+{
+	if (occluder)
+		buffer.AddOccluder(positions.data(), positions.size(), indices.data(), indices.size(), model);
+}
+
+// Gets how the Mesh's vertices are laid out on the gpu
+VertexFormat Mesh::GetFormat() const
+{
+	return format;
+}
+
+// Gets how much space the Mesh's vertices and indices take up on the gpu
+size_t Mesh::GpuBytes() const
+{
+	return gpuBytes;
+}
+
+// Points each texture's sampler uniform in the given shader at the texture's unit, and
+// finds the position unpacking uniforms. Only done when the Mesh is drawn with a different
+// shader than last time, since the units never change.
+void Mesh::findSamplers(const Shader& shader)
 {
 	unsigned int diffuseNr = 0;
 	unsigned int specularNr = 0;
 
 	for (unsigned int i = 0; i < textures.size(); ++i)
 	{
-		glActiveTexture(GL_TEXTURE0 + i); // all texture numbers are stored contiguously
-
 		// getting the proper uniform name to change
 		std::string number;
 		std::string name = textures[i].type;
@@ -58,41 +349,84 @@ void Mesh::Draw(Shader& shader)
 		else if (name == "texture_specular")
 			number = std::to_string(specularNr++);
 
-		shader.setInt(("material." + name + number).c_str(), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		shader.setInt(shader.Uniform("material." + name + number), textureUnits[i]);
 	}
-	glActiveTexture(GL_TEXTURE0);
-
-	// now drawing the mesh
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	positionMinUniform = shader.Uniform("positionMin");
+	positionExtentUniform = shader.Uniform("positionExtent");
+	samplerShader = shader.ID;
 }
 
-// Sets up the Mesh's buffers.
-void Mesh::SetupMesh()
+// Sets up the Mesh's buffers, or its space in the arena if it has one.
+void Mesh::SetupMesh(GeometryArena *arena)
 {
+	if (arena != NULL)
+	{
+		ArenaRange range;
+		if (arena->Allocate(vertices, indices, range))
+		{
+			arenaAllocation = ArenaAllocation(arena, range);
+			format = FLOAT_VERTICES;
+			gpuBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+			return;
+		}
+		std::cout << "ERROR::MESH::ARENA_FULL, using its own buffers" << std::endl;
+	}
+
 	// generating buffers
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
+	VAO = VertexArrayHandle::Create();
+	VBO = BufferHandle::Create();
+	EBO = BufferHandle::Create();
 
 	// inserting data
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+	if (format == PACKED_VERTICES)
+	{
+		std::vector<PackedVertex> packed = packVertices(vertices, bounds);
+		glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+		gpuBytes = packed.size() * sizeof(PackedVertex);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		gpuBytes = vertices.size() * sizeof(Vertex);
+	}
 
+	// indices only need 16 bits if there are few enough vertices to count with them
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	if (vertices.size() <= 65536)
+	{
+		std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_SHORT;
+		gpuBytes += shortIndices.size() * sizeof(unsigned short);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		gpuBytes += indices.size() * sizeof(unsigned int);
+	}
 
 	// attribute pointers
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-	glEnableVertexAttribArray(2);
+	if (format == PACKED_VERTICES)
+	{
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+		glEnableVertexAttribArray(2);
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+		glEnableVertexAttribArray(2);
+	}
 
 	// unbinding buffers
 	glBindVertexArray(0);
@@ -9,6 +9,11 @@
 
 // our headers
 #include "shader.h" // for Shader class
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle
+#include "geometryarena.h" // for GeometryArena, ArenaAllocation classes
+#include "frustum.h" // for Bounds struct
+#include "occlusion.h" // for OcclusionBuffer class
+#include "glstate.h" // for GLStateCache class
 
 struct Vertex {
 	glm::vec3 Position;
@@ -16,8 +21,38 @@ struct Vertex {
 	glm::vec2 TexCoords;
 };
 
+// A Vertex squeezed into half the space, for the gpu copy of meshes made with
+// PACKED_VERTICES. object.vert's PACKED_VERTICES variant unpacks it.
+struct PackedVertex {
+	unsigned short Position[4]; // 0 to 1 across the mesh's bounds, the last is padding
+	unsigned int Normal; // octahedral, as two snorm16s
+	unsigned int TexCoords; // two half floats
+};
+
+// How a Mesh's vertices are laid out on the gpu. The cpu copy's always full Vertexes.
+enum VertexFormat {
+	FLOAT_VERTICES, // as Vertex
+	PACKED_VERTICES // as PackedVertex, which needs the shader's PACKED_VERTICES variant
+};
+
+// where object.vert's INSTANCED variant reads each instance's model matrix from (it takes
+// up four locations)
+const unsigned int INSTANCE_ATTRIB = 4;
+
+// the texture units each kind of map is bound to, counting up from these. Units are fixed
+// by sampler, so a shader's samplers only ever need setting once.
+const unsigned int DIFFUSE_TEXTURE_UNIT = 0;
+const unsigned int SPECULAR_TEXTURE_UNIT = 4;
+
+// What a Mesh keeps of its vertex data on the cpu once it's been uploaded
+enum VertexResidency {
+	KEEP_VERTICES, // everything, as loaded
+	KEEP_POSITIONS, // just positions and indices, enough for collision
+	RELEASE_VERTICES // nothing, for meshes that are only ever drawn
+};
+
 struct Texture {
-	unsigned int id;
+	unsigned int id; // owned by the Model that loaded it
 	std::string type;
 	std::string path;
 };
@@ -25,19 +60,60 @@ struct Texture {
 class Mesh {
 	public:
 		std::vector<Vertex> vertices;
+		std::vector<glm::vec3> positions; // only filled in once vertices are released with KEEP_POSITIONS
 		std::vector<unsigned int> indices;
 		std::vector<Texture> textures;
 
-		Mesh(std::vector<Vertex>&, std::vector<unsigned int>&, std::vector<Texture>&);
-		Mesh(const Mesh&);
-		~Mesh();
+		Mesh(std::vector<Vertex>, std::vector<unsigned int>, std::vector<Texture>, GeometryArena* = NULL, VertexFormat = FLOAT_VERTICES);
+
+		// meshes own their buffers, so they can be moved around but never copied
+		Mesh(Mesh&&) = default;
+		Mesh& operator=(Mesh&&) = default;
 
 		void Draw(Shader&);
+		void DrawInstanced(Shader&, unsigned int);
+		void DrawElements(unsigned int = 0);
+		void AttachInstances(unsigned int);
+		bool Queue(const glm::mat4&);
+		void BindTextures(Shader&);
+		void BindTextures(Shader&, GLStateCache&);
+		void SetUnpacking(Shader&);
+		unsigned int GetVAO() const;
+		unsigned int GetMaterialID() const;
+		size_t ReleaseVertices(VertexResidency);
+		glm::vec3 GetPosition(unsigned int) const;
+		const Bounds& GetBounds() const;
+		bool MakeOccluder();
+		bool IsOccluder() const;
+		void AddOccluder(OcclusionBuffer&, const glm::mat4&) const;
+		VertexFormat GetFormat() const;
+		size_t GpuBytes() const;
 		
 	private:
-		unsigned int VAO, VBO, EBO;
+		VertexArrayHandle VAO;
+		BufferHandle VBO, EBO;
+		unsigned int indexCount;
+		GLenum indexType; // 16-bit where there are few enough vertices, unless it's in an arena
+		VertexFormat format;
+		size_t gpuBytes;
+		Bounds bounds; // worked out at load, so they're there whatever the residency policy
+		bool occluder;
+
+		// where the mesh lives instead, if it was made in an arena
+		ArenaAllocation arenaAllocation;
+
+		// the unit each texture's bound to, and an id shared by every Mesh with the same
+		// textures, for sorting by
+		std::vector<unsigned int> textureUnits;
+		unsigned int materialID;
+
+		// the last shader drawn with, whose samplers have been pointed at the Mesh's units,
+		// and where its position unpacking uniforms are
+		unsigned int samplerShader;
+		UniformHandle positionMinUniform, positionExtentUniform;
 
-		void SetupMesh();
+		void SetupMesh(GeometryArena*);
+		void findSamplers(const Shader&);
 };
 
 #endif
@@ -12,6 +12,10 @@
 #include <iostream> // for cin, cout, endl
 #include <string> // for string
 #include <vector> // for vector
+#include <utility> // for move
+#include <map> // for map
+#include <cmath> // for floor
+#include <algorithm> // for max
 
 // our headers
 #include "shader.h" // for Shader class
@@ -19,11 +23,25 @@
 #include "shapes.h" // for Triangle class
 #include "utils.h" // for utility functions
 #include "model.h" // for Model declaration
+#include "glhandles.h" // for TextureHandle, streamBuffer
+#include "geometryarena.h" // for GeometryArena class
+#include "frustum.h" // for Bounds struct, FrustumCuller class
+#include "occlusion.h" // for OcclusionBuffer class
 
-// Model Constructor
-Model::Model(const char *path)
+// Model Constructor. Nearby meshes sharing textures are merged first if batch is set, and
+// the meshes go in the arena if there is one. Once they're uploaded, they drop whatever
+// vertex data the residency policy says not to keep. Meshes with their own buffers are laid out
+// in the given format; ones in the arena use its.
+Model::Model(const char *path, VertexResidency residency, bool batch, GeometryArena *arena, VertexFormat format) : residency(residency), reclaimed(0)
 {
-	loadModel(path);
+	loadModel(path, batch, arena, format);
+
+	bounds = emptyBounds();
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		bounds = mergeBounds(bounds, meshes[i].GetBounds());
+		reclaimed += meshes[i].ReleaseVertices(residency);
+	}
 }
 
 // Draws the Model (by calling the Draw function of child Meshes).
@@ -35,10 +53,87 @@ void Model::Draw(Shader& shader)
 	}
 }
 
-// Converts the entire Model into Triangle shapes (for collision purposes).
+// Draws the Model once for each of the given model matrices, which the shader's INSTANCED
+// variant reads as a vertex attribute
+void Model::DrawInstanced(Shader& shader, const std::vector<glm::mat4> &models)
+{
+	if (models.empty())
+		return;
+
+	UploadInstances(models);
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		meshes[i].DrawInstanced(shader, models.size());
+	}
+}
+
+// Fills the instance buffer with the given model matrices, for the next instanced draws
+void Model::UploadInstances(const std::vector<glm::mat4> &models)
+{
+	if (instanceBuffer == 0)
+	{
+		instanceBuffer = BufferHandle::Create();
+		for (unsigned int i = 0; i < meshes.size(); ++i)
+		{
+			meshes[i].AttachInstances(instanceBuffer);
+		}
+	}
+
+	size_t bytes = models.size() * sizeof(glm::mat4);
+	streamBuffer(GL_ARRAY_BUFFER, instanceBuffer, bytes, bytes, models.data());
+}
+
+// Adds an instanced draw of each of the Model's meshes to a render queue, using whatever's
+// in the instance buffer, so UploadInstances has to have been called first
+void Model::AddInstanced(RenderQueue &queue, Shader &shader, unsigned int instances, float depth)
+{
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		queue.AddInstanced(meshes[i], shader, instances, depth);
+	}
+}
+
+// Queues the Model's meshes in their arena with the given model matrix, to be drawn when
+// the arena's submitted. Only works for Models made in an arena.
+void Model::Queue(const glm::mat4 &model)
+{
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		meshes[i].Queue(model);
+	}
+}
+
+// Queues just the Model's meshes that are in the culler's frustum. Returns how many were
+// queued.
+unsigned int Model::Queue(const glm::mat4 &model, FrustumCuller &culler)
+{
+	culler.Clear();
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		culler.Add(meshes[i].GetBounds(), model);
+	}
+	culler.Cull();
+
+	unsigned int queued = 0;
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		if (culler.Visible(i) && meshes[i].Queue(model))
+			++queued;
+	}
+	return queued;
+}
+
+// Converts the entire Model into Triangle shapes (for collision purposes). Needs the
+// Model to have kept at least its positions.
 std::vector<Triangle> Model::ToTriangles()
 {
 	std::vector<Triangle> ret;
+	if (residency == RELEASE_VERTICES)
+	{
+		std::cout << "ERROR::MODEL::VERTICES_RELEASED, can't make triangles" << std::endl;
+		return ret;
+	}
+
 	for (unsigned int i = 0; i < meshes.size(); ++i)
 	{
 		for (unsigned int j = 0; j < meshes[i].indices.size(); j += 3)
@@ -46,7 +141,7 @@ std::vector<Triangle> Model::ToTriangles()
 			glm::vec3 vertices[3];
 			for (unsigned int k = 0; k < 3; ++k)
 			{
-				vertices[k] = meshes[i].vertices[meshes[i].indices[j+k]].Position;
+				vertices[k] = meshes[i].GetPosition(meshes[i].indices[j+k]);
 			}
 			ret.push_back(Triangle(vertices[0], vertices[1], vertices[2]));
 		}
@@ -54,8 +149,80 @@ std::vector<Triangle> Model::ToTriangles()
 	return ret;
 }
 
+// Checks whether any of the Model's meshes has a specular map, for picking a shader variant
+bool Model::HasSpecularMaps() const
+{
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		for (unsigned int j = 0; j < meshes[i].textures.size(); ++j)
+		{
+			if (meshes[i].textures[j].type == "texture_specular")
+				return true;
+		}
+	}
+	return false;
+}
+
+// Gets what the Model keeps of its vertex data on the cpu
+VertexResidency Model::GetResidency() const
+{
+	return residency;
+}
+
+// Gets how many bytes of vertex data the Model freed after uploading it
+size_t Model::ReclaimedBytes() const
+{
+	return reclaimed;
+}
+
+// Gets how many meshes (so draw calls) the Model has
+unsigned int Model::NumMeshes() const
+{
+	return meshes.size();
+}
+
+// Gets how much space the Model's meshes take up on the gpu
+size_t Model::GpuBytes() const
+{
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		bytes += meshes[i].GpuBytes();
+	}
+	return bytes;
+}
+
+// Gets the box and sphere around the whole Model, in model space
+const Bounds& Model::GetBounds() const
+{
+	return bounds;
+}
+
+// Makes every mesh at least the given size an occluder. Small meshes don't hide much and
+// would only slow the occlusion buffer down. Returns how many became occluders, which is
+// none if the Model didn't keep its positions.
+unsigned int Model::DesignateOccluders(float minRadius)
+{
+	unsigned int occluders = 0;
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		if (meshes[i].GetBounds().Radius >= minRadius && meshes[i].MakeOccluder())
+			++occluders;
+	}
+	return occluders;
+}
+
+// Rasterizes the Model's occluders into an occlusion buffer with the given model matrix
+void Model::AddOccluders(OcclusionBuffer &buffer, const glm::mat4 &model) const
+{
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		meshes[i].AddOccluder(buffer, model);
+	}
+}
+
 // Loads a Model given a path.
-void Model::loadModel(std::string path)
+void Model::loadModel(std::string path, bool batch, GeometryArena *arena, VertexFormat format)
 {
 	Assimp::Importer importer;
 	const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
@@ -67,28 +234,98 @@ void Model::loadModel(std::string path)
 	}
 	directory = path.substr(0, path.find_last_of('/'));
 
-	processNode(scene->mRootNode, scene);
+	// reading every mesh first, so batching can happen before anything is uploaded
+	std::vector<MeshData> data;
+	processNode(scene->mRootNode, scene, data);
+	if (batch)
+		batchMeshes(data);
+
+	meshes.reserve(data.size());
+	for (unsigned int i = 0; i < data.size(); ++i)
+	{
+		meshes.push_back(Mesh(std::move(data[i].Vertices), std::move(data[i].Indices), std::move(data[i].Textures), arena, format));
+	}
 }
 
 // Processes a node of a Model's scene.
-void Model::processNode(aiNode *node, const aiScene *scene)
+void Model::processNode(aiNode *node, const aiScene *scene, std::vector<MeshData> &data)
 {
 	// process node's meshes if there are any
 	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
 	{
 		aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(mesh, scene));
+		data.push_back(processMesh(mesh, scene));
 	}
 
 	// then do so for child nodes
 	for (unsigned int i = 0; i < node->mNumChildren; ++i)
 	{
-		processNode(node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, data);
 	}
 }
 
+// Merges meshes that use exactly the same textures and sit in the same BATCH_CELL_SIZE
+// grid cell into one, so the Model takes a draw call per material per cell instead of one
+// per mesh. Keeping batches to a cell keeps their bounds small enough to be culled, and
+// meshes bigger than a cell (floors, walls) are left alone so they stay useful occluders.
+// Node transforms aren't applied to meshes anyway, so they can be merged as they are.
+void Model::batchMeshes(std::vector<MeshData> &data)
+{
+	std::vector<MeshData> batched;
+	std::map<std::string, unsigned int> batchOf; // texture set and cell -> index in batched
+
+	for (unsigned int i = 0; i < data.size(); ++i)
+	{
+		if (data[i].Vertices.empty())
+		{
+			batched.push_back(std::move(data[i]));
+			continue;
+		}
+
+		glm::vec3 boxMin = data[i].Vertices[0].Position, boxMax = boxMin;
+		for (unsigned int j = 1; j < data[i].Vertices.size(); ++j)
+		{
+			boxMin = glm::min(boxMin, data[i].Vertices[j].Position);
+			boxMax = glm::max(boxMax, data[i].Vertices[j].Position);
+		}
+		glm::vec3 size = boxMax - boxMin;
+		if (std::max(size.x, std::max(size.y, size.z)) > BATCH_CELL_SIZE)
+		{
+			batched.push_back(std::move(data[i]));
+			continue;
+		}
+
+		glm::vec3 cell = glm::floor((boxMin + boxMax) * 0.5f / BATCH_CELL_SIZE);
+		std::string key = std::to_string((int)cell.x) + "," + std::to_string((int)cell.y) + "," + std::to_string((int)cell.z) + ":";
+		for (unsigned int j = 0; j < data[i].Textures.size(); ++j)
+		{
+			key += std::to_string(data[i].Textures[j].id) + data[i].Textures[j].type + ";";
+		}
+
+		std::map<std::string, unsigned int>::iterator it = batchOf.find(key);
+		if (it == batchOf.end())
+		{
+			batchOf[key] = batched.size();
+			batched.push_back(std::move(data[i]));
+			continue;
+		}
+
+		// appending this mesh's vertices, and its indices shifted past the ones already there
+		MeshData &batch = batched[it->second];
+		unsigned int base = batch.Vertices.size();
+		batch.Vertices.insert(batch.Vertices.end(), data[i].Vertices.begin(), data[i].Vertices.end());
+		batch.Indices.reserve(batch.Indices.size() + data[i].Indices.size());
+		for (unsigned int j = 0; j < data[i].Indices.size(); ++j)
+		{
+			batch.Indices.push_back(data[i].Indices[j] + base);
+		}
+	}
+
+	data.swap(batched);
+}
+
 // Processes a Mesh of a Model's node.
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
+MeshData Model::processMesh(aiMesh *mesh, const aiScene *scene)
 {
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
@@ -145,7 +382,11 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 	}
 
-	return Mesh(vertices, indices, textures);
+	MeshData data;
+	data.Vertices = std::move(vertices);
+	data.Indices = std::move(indices);
+	data.Textures = std::move(textures);
+	return data;
 }
 
 // Loads a material's textures.
@@ -175,6 +416,7 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType
 			texture.path = str.C_Str();
 			textures.push_back(texture);
 			textures_loaded.push_back(texture);
+			textureHandles.push_back(TextureHandle(texture.id));
 		}
 	}
 	return textures;
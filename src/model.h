@@ -17,23 +17,68 @@
 #include "shader.h" // for Shader class
 #include "mesh.h" // for Mesh class
 #include "shapes.h" // for Triangle class
+#include "glhandles.h" // for TextureHandle
+#include "geometryarena.h" // for GeometryArena class
+#include "frustum.h" // for Bounds struct, FrustumCuller class
+#include "occlusion.h" // for OcclusionBuffer class
+#include "renderqueue.h" // for RenderQueue class
+
+// what models keep of their vertex data on the cpu by default
+const VertexResidency RESIDENCY = KEEP_VERTICES;
+// whether models merge meshes that share textures by default
+const bool BATCH_MESHES = false;
+// how big the grid cells are that batches are kept within, so they can still be culled
+const float BATCH_CELL_SIZE = 8.0f;
+// how models lay out their vertices on the gpu by default
+const VertexFormat VERTEX_FORMAT = FLOAT_VERTICES;
+// how big (bounding sphere radius) a mesh has to be to be worth rasterizing as an occluder
+const float OCCLUDER_MIN_RADIUS = 1.0f;
+
+// A mesh's data as it comes out of the file, before it's uploaded as a Mesh
+struct MeshData {
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+	std::vector<Texture> Textures;
+};
 
 class Model
 {
 	public:
-		Model(const char*);
+		Model(const char*, VertexResidency = RESIDENCY, bool = BATCH_MESHES, GeometryArena* = NULL, VertexFormat = VERTEX_FORMAT);
 		
 		void Draw(Shader&);
+		void DrawInstanced(Shader&, const std::vector<glm::mat4>&);
+		void UploadInstances(const std::vector<glm::mat4>&);
+		void AddInstanced(RenderQueue&, Shader&, unsigned int, float = 0.0f);
+		void Queue(const glm::mat4&);
+		unsigned int Queue(const glm::mat4&, FrustumCuller&);
 		std::vector<Triangle> ToTriangles();
+		bool HasSpecularMaps() const;
+		VertexResidency GetResidency() const;
+		size_t ReclaimedBytes() const;
+		unsigned int NumMeshes() const;
+		size_t GpuBytes() const;
+		const Bounds& GetBounds() const;
+		unsigned int DesignateOccluders(float = OCCLUDER_MIN_RADIUS);
+		void AddOccluders(OcclusionBuffer&, const glm::mat4&) const;
 
 	private:
 		std::vector<Mesh> meshes;
+		VertexResidency residency;
+		size_t reclaimed;
+		Bounds bounds; // around all the meshes
+
+		// per-instance model matrices, only made the first time the Model's drawn instanced
+		BufferHandle instanceBuffer;
+
 		std::string directory;
 		std::vector<Texture> textures_loaded;
+		std::vector<TextureHandle> textureHandles; // the meshes share textures, so the model owns them
 
-		void loadModel(std::string);
-		void processNode(aiNode*, const aiScene*);
-		Mesh processMesh(aiMesh*, const aiScene*);
+		void loadModel(std::string, bool, GeometryArena*, VertexFormat);
+		void processNode(aiNode*, const aiScene*, std::vector<MeshData>&);
+		MeshData processMesh(aiMesh*, const aiScene*);
+		void batchMeshes(std::vector<MeshData>&);
 		std::vector<Texture> loadMaterialTextures(aiMaterial*, aiTextureType, std::string);
 };
 
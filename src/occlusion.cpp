@@ -0,0 +1,258 @@
+// occlusion.cpp
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <algorithm> // for min, max, fill, swap
+#include <cmath> // for floor, ceil
+using namespace std;
+
+// our files
+#include "occlusion.h" // for OcclusionBuffer declaration
+
+// OcclusionBuffer Constructor, given its size in pixels
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) : width(width), height(height), viewProjection(1.0f), occluderTriangles(0), tested(0), occluded(0) {
+	depth.resize(width * height, 1.0f);
+
+	// making the pyramid's levels, down to a single texel
+	unsigned int levelWidth = width, levelHeight = height;
+	while (true) {
+		levelWidths.push_back(levelWidth);
+		levelHeights.push_back(levelHeight);
+		nearest.push_back(vector<float>(levelWidth * levelHeight, 1.0f));
+		farthest.push_back(vector<float>(levelWidth * levelHeight, 1.0f));
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+		levelWidth = max(1u, levelWidth / 2);
+		levelHeight = max(1u, levelHeight / 2);
+	}
+}
+
+// Starts a new frame seen through projection * view, clearing the buffer to the far plane
+void OcclusionBuffer::Begin(const glm::mat4 &viewProj) {
+	viewProjection = viewProj;
+	fill(depth.begin(), depth.end(), 1.0f);
+	occluderTriangles = 0;
+	tested = 0;
+	occluded = 0;
+}
+
+// Rasterizes an occluder, given its positions, its triangles' indices and its model matrix
+void OcclusionBuffer::AddOccluder(const glm::vec3 *positions, unsigned int numPositions, const unsigned int *indices, unsigned int numIndices, const glm::mat4 &model) {
+	glm::mat4 mvp = viewProjection * model;
+	clipPositions.resize(numPositions);
+	for (unsigned int i = 0; i < numPositions; ++i)
+		clipPositions[i] = mvp * glm::vec4(positions[i], 1.0f);
+
+	for (unsigned int i = 0; i + 2 < numIndices; i += 3)
+		rasterize(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]);
+}
+
+// Rasterizes a single occluding triangle, given in world space
+void OcclusionBuffer::AddTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+	rasterize(viewProjection * glm::vec4(a, 1.0f), viewProjection * glm::vec4(b, 1.0f), viewProjection * glm::vec4(c, 1.0f));
+}
+
+// Builds the pyramid from the buffer. Has to be done after the occluders are in and before
+// anything's tested.
+void OcclusionBuffer::Finish() {
+	copy(depth.begin(), depth.end(), nearest[0].begin());
+	copy(depth.begin(), depth.end(), farthest[0].begin());
+
+	for (unsigned int l = 1; l < levelWidths.size(); ++l) {
+		unsigned int prevWidth = levelWidths[l - 1], prevHeight = levelHeights[l - 1];
+		const vector<float> &prevNear = nearest[l - 1], &prevFar = farthest[l - 1];
+
+		for (unsigned int y = 0; y < levelHeights[l]; ++y) {
+			// a level that's only one texel tall (or wide) just takes the one below it
+			unsigned int y0 = min(y * 2, prevHeight - 1), y1 = min(y * 2 + 1, prevHeight - 1);
+			for (unsigned int x = 0; x < levelWidths[l]; ++x) {
+				unsigned int x0 = min(x * 2, prevWidth - 1), x1 = min(x * 2 + 1, prevWidth - 1);
+				unsigned int texels[4] = {y0 * prevWidth + x0, y0 * prevWidth + x1, y1 * prevWidth + x0, y1 * prevWidth + x1};
+
+				float lo = prevNear[texels[0]], hi = prevFar[texels[0]];
+				for (unsigned int i = 1; i < 4; ++i) {
+					lo = min(lo, prevNear[texels[i]]);
+					hi = max(hi, prevFar[texels[i]]);
+				}
+				nearest[l][y * levelWidths[l] + x] = lo;
+				farthest[l][y * levelWidths[l] + x] = hi;
+			}
+		}
+	}
+}
+
+// Checks whether a world space box might be visible past the occluders. Only says no when
+// every texel it covers has an occluder in front of its nearest point.
+bool OcclusionBuffer::BoxVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) {
+	++tested;
+
+	float minX = width, minY = height, maxX = 0.0f, maxY = 0.0f, minZ = 1.0f;
+	for (unsigned int i = 0; i < 8; ++i) {
+		glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+		// boxes reaching past the near plane are right in front of the camera
+		if (clip.z < -clip.w)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * width;
+		float y = (clip.y * invW * 0.5f + 0.5f) * height;
+		minX = min(minX, x);
+		maxX = max(maxX, x);
+		minY = min(minY, y);
+		maxY = max(maxY, y);
+		minZ = min(minZ, clip.z * invW * 0.5f + 0.5f);
+	}
+
+	// anything off the screen is left to the frustum culling
+	int x0 = max(0, (int)floor(minX)), x1 = min((int)width - 1, (int)floor(maxX));
+	int y0 = max(0, (int)floor(minY)), y1 = min((int)height - 1, (int)floor(maxY));
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	// occluders cover every pixel whose centre they cover, which can be more than they
+	// really do at their edges, so the box is tested a pixel wider all round to make up
+	// for it
+	x0 = max(0, x0 - 1);
+	x1 = min((int)width - 1, x1 + 1);
+	y0 = max(0, y0 - 1);
+	y1 = min((int)height - 1, y1 + 1);
+
+	// nearer than every occluder on screen
+	if (minZ <= nearest.back()[0])
+		return true;
+
+	// going up the pyramid until the box only covers a couple of texels each way
+	unsigned int level = 0;
+	while (level + 1 < levelWidths.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		++level;
+
+	unsigned int levelWidth = levelWidths[level], levelHeight = levelHeights[level];
+	const vector<float> &levelFar = farthest[level];
+	for (unsigned int y = y0 >> level; y <= min((unsigned int)y1 >> level, levelHeight - 1); ++y) {
+		for (unsigned int x = x0 >> level; x <= min((unsigned int)x1 >> level, levelWidth - 1); ++x) {
+			if (minZ <= levelFar[y * levelWidth + x])
+				return true;
+		}
+	}
+
+	++occluded;
+	return false;
+}
+
+// Gets the buffer's width in pixels
+unsigned int OcclusionBuffer::Width() const {
+	return width;
+}
+
+// Gets the buffer's height in pixels
+unsigned int OcclusionBuffer::Height() const {
+	return height;
+}
+
+// Gets the depth at a pixel, 0 at the near plane and 1 at the far one (or nothing drawn)
+float OcclusionBuffer::GetDepth(unsigned int x, unsigned int y) const {
+	return depth[y * width + x];
+}
+
+// Gets how many levels the pyramid has, including the full size one
+unsigned int OcclusionBuffer::NumLevels() const {
+	return levelWidths.size();
+}
+
+// Gets how many occluder triangles were rasterized since Begin
+unsigned int OcclusionBuffer::NumOccluderTriangles() const {
+	return occluderTriangles;
+}
+
+// Gets how many boxes were tested since Begin
+unsigned int OcclusionBuffer::NumTested() const {
+	return tested;
+}
+
+// Gets how many boxes were found to be hidden since Begin
+unsigned int OcclusionBuffer::NumOccluded() const {
+	return occluded;
+}
+
+// Clips a triangle in clip space against the near plane, then rasterizes what's left of it
+void OcclusionBuffer::rasterize(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c) {
+	// skipping triangles wholly off one side of the screen
+	if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w))
+		return;
+	if ((a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w))
+		return;
+
+	// clipping to z >= -w, which leaves at most four corners
+	const glm::vec4 in[3] = {a, b, c};
+	glm::vec4 out[4];
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < 3; ++i) {
+		const glm::vec4 &p = in[i], &q = in[(i + 1) % 3];
+		float dp = p.z + p.w, dq = q.z + q.w;
+		if (dp >= 0.0f)
+			out[count++] = p;
+		if ((dp >= 0.0f) != (dq >= 0.0f)) {
+			float t = dp / (dp - dq);
+			out[count++] = p + (q - p) * t;
+		}
+	}
+	if (count < 3)
+		return;
+
+	glm::vec3 screen[4];
+	for (unsigned int i = 0; i < count; ++i) {
+		float invW = 1.0f / out[i].w;
+		screen[i] = glm::vec3((out[i].x * invW * 0.5f + 0.5f) * width, (out[i].y * invW * 0.5f + 0.5f) * height, out[i].z * invW * 0.5f + 0.5f);
+	}
+
+	for (unsigned int i = 1; i + 1 < count; ++i)
+		rasterizeScreen(screen[0], screen[i], screen[i + 1]);
+}
+
+// Rasterizes a triangle in pixel coordinates, keeping the nearest depth at each pixel
+// center it covers. The edge functions and depth are linear along a row, so each row is a
+// loop the compiler can vectorize.
+void OcclusionBuffer::rasterizeScreen(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (area < 0.0f) {
+		swap(b, c);
+		area = -area;
+	}
+	if (area < 1e-6f)
+		return;
+	++occluderTriangles;
+
+	int x0 = max(0, (int)floor(min(a.x, min(b.x, c.x))));
+	int x1 = min((int)width - 1, (int)ceil(max(a.x, max(b.x, c.x))));
+	int y0 = max(0, (int)floor(min(a.y, min(b.y, c.y))));
+	int y1 = min((int)height - 1, (int)ceil(max(a.y, max(b.y, c.y))));
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	// how each edge function (which is positive inside) changes per pixel across
+	float stepBC = -(c.y - b.y), stepCA = -(a.y - c.y), stepAB = -(b.y - a.y);
+	float invArea = 1.0f / area;
+	float stepZ = (stepBC * a.z + stepCA * b.z + stepAB * c.z) * invArea;
+
+	unsigned int count = x1 - x0 + 1;
+	for (int y = y0; y <= y1; ++y) {
+		float px = x0 + 0.5f, py = y + 0.5f;
+		float edgeBC = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+		float edgeCA = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+		float edgeAB = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+		float rowZ = (edgeBC * a.z + edgeCA * b.z + edgeAB * c.z) * invArea;
+
+		float *__restrict row = &depth[y * width + x0];
+		for (unsigned int i = 0; i < count; ++i) {
+			float f = (float)i;
+			bool inside = (edgeBC + f * stepBC >= 0.0f) & (edgeCA + f * stepCA >= 0.0f) & (edgeAB + f * stepAB >= 0.0f);
+			float nearer = min(row[i], rowZ + f * stepZ);
+			row[i] = inside ? nearer : row[i];
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+// occlusion.h
+// Defines the OcclusionBuffer class, a small depth buffer drawn on the cpu that tells
+// whether something's hidden behind the level's walls before it's sent to gl.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+
+const unsigned int OCCLUSION_WIDTH = 256; // both powers of two, to keep the pyramid simple
+const unsigned int OCCLUSION_HEIGHT = 128;
+
+// OcclusionBuffer class
+// Each frame the occluders are rasterized into it (depths from 0 at the near plane to 1 at
+// the far one), then it's finished into a pyramid of lower resolution copies holding the
+// nearest and farthest depth under each texel. Boxes are tested at whichever level they
+// cover a couple of texels of, so testing one costs about the same however big it is on
+// screen. Nothing here touches gl, so it can be run and checked without a window.
+class OcclusionBuffer {
+	public:
+		OcclusionBuffer(unsigned int = OCCLUSION_WIDTH, unsigned int = OCCLUSION_HEIGHT);
+
+		void Begin(const glm::mat4&);
+		void AddOccluder(const glm::vec3*, unsigned int, const unsigned int*, unsigned int, const glm::mat4&);
+		void AddTriangle(const glm::vec3&, const glm::vec3&, const glm::vec3&);
+		void Finish();
+
+		bool BoxVisible(const glm::vec3&, const glm::vec3&);
+
+		unsigned int Width() const;
+		unsigned int Height() const;
+		float GetDepth(unsigned int, unsigned int) const;
+		unsigned int NumLevels() const;
+		unsigned int NumOccluderTriangles() const;
+		unsigned int NumTested() const;
+		unsigned int NumOccluded() const;
+
+	private:
+		unsigned int width, height;
+		glm::mat4 viewProjection;
+
+		std::vector<float> depth;
+		// level 0 is the full buffer, each one after is half the size of the one before
+		std::vector<std::vector<float> > nearest, farthest;
+		std::vector<unsigned int> levelWidths, levelHeights;
+
+		std::vector<glm::vec4> clipPositions; // scratch space for occluders, so they don't allocate
+
+		// since the last Begin
+		unsigned int occluderTriangles, tested, occluded;
+
+		void rasterize(const glm::vec4&, const glm::vec4&, const glm::vec4&);
+		void rasterizeScreen(glm::vec3, glm::vec3, glm::vec3);
+};
+
+#endif
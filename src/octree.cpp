@@ -1,8 +1,13 @@
 // octree.cpp
 
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
 // stdlib
 #include <iostream> // for cout
 #include <vector> // for vector
+#include <cfloat> // for FLT_MAX
+#include <algorithm> // for max
 using namespace std;
 
 // our files
@@ -10,7 +15,7 @@ using namespace std;
 #include "shapes.h" // for shape classes
 
 // Octree constructor
-Octree::Octree(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax) : subdivided(false) {
+Octree::Octree(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax, unsigned int depth) : depth(depth), boundsMin(FLT_MAX), boundsMax(-FLT_MAX), subdivided(false) {
 	xMin = xmin;
 	xMax = xmax;
 	yMin = ymin;
@@ -19,42 +24,186 @@ Octree::Octree(float xmin, float xmax, float ymin, float ymax, float zmin, float
 	zMax = zmax;
 }
 
-// Octree constructor
-Octree::Octree(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax, vector<Triangle> tris) : subdivided(false) {
-	xMin = xmin;
-	xMax = xmax;
-	yMin = ymin;
-	yMax = ymax;
-	zMin = zmin;
-	zMax = zmax;
+// Octree constructor, sizing the root to fit all of the given triangles
+Octree::Octree(const vector<Triangle> &tris) : depth(0), boundsMin(FLT_MAX), boundsMax(-FLT_MAX), subdivided(false) {
+	glm::vec3 minCorner(FLT_MAX), maxCorner(-FLT_MAX);
+	for (unsigned int i = 0; i < tris.size(); ++i) {
+		glm::vec3 triMin, triMax;
+		triangleBounds(tris[i], triMin, triMax);
+		minCorner = glm::min(minCorner, triMin);
+		maxCorner = glm::max(maxCorner, triMax);
+	}
+	if (tris.empty()) {
+		minCorner = glm::vec3(0.0f);
+		maxCorner = glm::vec3(0.0f);
+	}
+
+	// keeping the root a cube, so that cells stay cubes as they get split
+	glm::vec3 center = (minCorner + maxCorner) / 2.0f;
+	glm::vec3 extent = maxCorner - minCorner;
+	float halfSize = std::max(extent.x, std::max(extent.y, extent.z)) / 2.0f;
+	minCorner = center - glm::vec3(halfSize);
+	maxCorner = center + glm::vec3(halfSize);
+
+	xMin = minCorner.x;
+	xMax = maxCorner.x;
+	yMin = minCorner.y;
+	yMax = maxCorner.y;
+	zMin = minCorner.z;
+	zMax = maxCorner.z;
 
 	Insert(tris);
 }
 
-// Inserts a single triangle into the octree
+// Inserts a single triangle (by its index into tris) into the octree
 // Returns whether or not the triangle could be inserted
-bool Octree::Insert(Triangle tri) {
-	octreeTris.push_back(tri);
-	// general plan:
+bool Octree::Insert(const vector<Triangle> &tris, unsigned int index) {
 	// firstly, check if the triangle even fits in the octree bounding box
-	//   if not then just return false to indicate failed insertion
-	//   but if you can feasibly Insert it, remember to return true at the end!
-	// then, if there are no sub-octrees:
-	//   if there are no triangles in the octreeTris array, just push the triangle into that array
-	//   else, subdivide into sub-octrees, try to push each triangle into those
-	// else, if there are sub-octrees:
-	//   just try to Insert into each sub-octree until one returns true
-	//   and if that doesn't work just push to the octreeTris array
+	glm::vec3 triMin, triMax;
+	triangleBounds(tris[index], triMin, triMax);
+	if (!fits(triMin, triMax))
+		return false;
+
+	boundsMin = glm::min(boundsMin, triMin);
+	boundsMax = glm::max(boundsMax, triMax);
+
+	// then, if there are no sub-octrees, either keep the triangle here or subdivide
+	if (!subdivided) {
+		if (octreeTris.size() < OCTREE_MAX_TRIS || depth >= OCTREE_MAX_DEPTH) {
+			octreeTris.push_back(index);
+			return true;
+		}
+		subdivide(tris);
+	}
+
+	// if there are sub-octrees, try the one the triangle's center falls in, and if that
+	// doesn't work (the triangle is too big for it) just keep it here
+	if (!subOctrees[childFor(triMin, triMax)].Insert(tris, index))
+		octreeTris.push_back(index);
 	return true;
 }
 
-// Inserts a vector of triangles into the octree
+// Inserts every triangle of a vector into the octree
 // Returns whether or not all triangles could be inserted
-bool Octree::Insert(vector<Triangle> tris) {
+bool Octree::Insert(const vector<Triangle> &tris) {
 	bool allInserted = true;
 	for (unsigned int i = 0; i < tris.size(); ++i) {
-		allInserted = allInserted && Insert(tris.at(i));
+		allInserted = Insert(tris, i) && allInserted;
 	}
 	return allInserted;
 }
 
+// Appends the index of every triangle whose bounding box overlaps the query box
+void Octree::Query(const vector<Triangle> &tris, const glm::vec3 &queryMin, const glm::vec3 &queryMax, vector<unsigned int> &out) const {
+	if (!Overlaps(queryMin, queryMax))
+		return;
+
+	for (unsigned int i = 0; i < octreeTris.size(); ++i) {
+		glm::vec3 triMin, triMax;
+		triangleBounds(tris[octreeTris[i]], triMin, triMax);
+		if (queryMin.x > triMax.x || queryMax.x < triMin.x ||
+		    queryMin.y > triMax.y || queryMax.y < triMin.y ||
+		    queryMin.z > triMax.z || queryMax.z < triMin.z)
+			continue;
+		out.push_back(octreeTris[i]);
+	}
+
+	for (unsigned int i = 0; i < subOctrees.size(); ++i) {
+		subOctrees[i].Query(tris, queryMin, queryMax, out);
+	}
+}
+
+// Recomputes every node's tight bounds after the triangles have moved, without changing
+// which node any triangle is in. Used for geometry that moves as a whole, where the
+// triangles stay close to their neighbours, so the old layout stays good enough.
+void Octree::Refit(const vector<Triangle> &tris) {
+	boundsMin = glm::vec3(FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX);
+
+	for (unsigned int i = 0; i < octreeTris.size(); ++i) {
+		glm::vec3 triMin, triMax;
+		triangleBounds(tris[octreeTris[i]], triMin, triMax);
+		boundsMin = glm::min(boundsMin, triMin);
+		boundsMax = glm::max(boundsMax, triMax);
+	}
+
+	for (unsigned int i = 0; i < subOctrees.size(); ++i) {
+		subOctrees[i].Refit(tris);
+		boundsMin = glm::min(boundsMin, subOctrees[i].boundsMin);
+		boundsMax = glm::max(boundsMax, subOctrees[i].boundsMax);
+	}
+}
+
+// Checks whether a box overlaps the tight bounds of everything in the octree
+bool Octree::Overlaps(const glm::vec3 &queryMin, const glm::vec3 &queryMax) const {
+	return !(queryMin.x > boundsMax.x || queryMax.x < boundsMin.x ||
+	         queryMin.y > boundsMax.y || queryMax.y < boundsMin.y ||
+	         queryMin.z > boundsMax.z || queryMax.z < boundsMin.z);
+}
+
+// Finds roughly how many bytes the octree takes up, not counting the triangles themselves
+size_t Octree::MemoryUsage() const {
+	size_t bytes = sizeof(Octree) + octreeTris.capacity() * sizeof(unsigned int);
+	bytes += (subOctrees.capacity() - subOctrees.size()) * sizeof(Octree);
+	for (unsigned int i = 0; i < subOctrees.size(); ++i) {
+		bytes += subOctrees[i].MemoryUsage();
+	}
+	return bytes;
+}
+
+// Checks whether a bounding box lies entirely within this octree's cell. Cells are loose,
+// so small triangles that straddle a split still get pushed down instead of all piling up
+// in the parent. Queries use the tight bounds, so the overlap doesn't cost correctness.
+bool Octree::fits(const glm::vec3 &minCorner, const glm::vec3 &maxCorner) const {
+	float xPad = (xMax - xMin) * OCTREE_LOOSENESS;
+	float yPad = (yMax - yMin) * OCTREE_LOOSENESS;
+	float zPad = (zMax - zMin) * OCTREE_LOOSENESS;
+	return minCorner.x >= xMin - xPad && maxCorner.x <= xMax + xPad &&
+	       minCorner.y >= yMin - yPad && maxCorner.y <= yMax + yPad &&
+	       minCorner.z >= zMin - zPad && maxCorner.z <= zMax + zPad;
+}
+
+// Splits this octree into eight sub-octrees, and pushes down whichever of its triangles fit
+void Octree::subdivide(const vector<Triangle> &tris) {
+	float xMid = (xMin + xMax) / 2.0f;
+	float yMid = (yMin + yMax) / 2.0f;
+	float zMid = (zMin + zMax) / 2.0f;
+
+	subOctrees.reserve(8);
+	for (unsigned int i = 0; i < 8; ++i) {
+		subOctrees.push_back(Octree(
+			(i & 1) ? xMid : xMin, (i & 1) ? xMax : xMid,
+			(i & 2) ? yMid : yMin, (i & 2) ? yMax : yMid,
+			(i & 4) ? zMid : zMin, (i & 4) ? zMax : zMid,
+			depth + 1));
+	}
+	subdivided = true;
+
+	vector<unsigned int> kept;
+	for (unsigned int i = 0; i < octreeTris.size(); ++i) {
+		glm::vec3 triMin, triMax;
+		triangleBounds(tris[octreeTris[i]], triMin, triMax);
+		if (!subOctrees[childFor(triMin, triMax)].Insert(tris, octreeTris[i]))
+			kept.push_back(octreeTris[i]);
+	}
+	octreeTris = kept;
+}
+
+// Finds which sub-octree the center of a bounding box falls in
+unsigned int Octree::childFor(const glm::vec3 &minCorner, const glm::vec3 &maxCorner) const {
+	glm::vec3 center = (minCorner + maxCorner) / 2.0f;
+	unsigned int child = 0;
+	if (center.x >= (xMin + xMax) / 2.0f)
+		child |= 1;
+	if (center.y >= (yMin + yMax) / 2.0f)
+		child |= 2;
+	if (center.z >= (zMin + zMax) / 2.0f)
+		child |= 4;
+	return child;
+}
+
+// Finds the axis-aligned bounding box of a triangle
+void triangleBounds(const Triangle &tri, glm::vec3 &minCorner, glm::vec3 &maxCorner) {
+	minCorner = glm::min(tri.Vertices[0], glm::min(tri.Vertices[1], tri.Vertices[2]));
+	maxCorner = glm::max(tri.Vertices[0], glm::max(tri.Vertices[1], tri.Vertices[2]));
+}
@@ -3,29 +3,58 @@
 // octree.h
 // Defines the octree class, used to create an octree for efficient collision handling
 
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
 // stdlib
 #include <vector> // for vector
+#include <cstddef> // for size_t
 
 // our files
 #include "shapes.h" // for shape classes
 
+const unsigned int OCTREE_MAX_TRIS = 16; // triangles a node holds before subdividing
+const unsigned int OCTREE_MAX_DEPTH = 8;
+const float OCTREE_LOOSENESS = 0.5f; // how far past its cell a node accepts triangles, per cell size
+
+// Octree class. Stores indices into a triangle vector owned by someone else, so the same
+// triangles can be shared between the octree and whatever is colliding with them.
 class Octree {
 	public:
-		Octree(float, float, float, float, float, float);
-		Octree(float, float, float, float, float, float, std::vector<Triangle>);
+		Octree(float, float, float, float, float, float, unsigned int = 0);
+		Octree(const std::vector<Triangle>&);
+
+		bool Insert(const std::vector<Triangle>&, unsigned int);
+		bool Insert(const std::vector<Triangle>&);
+
+		void Query(const std::vector<Triangle>&, const glm::vec3&, const glm::vec3&, std::vector<unsigned int>&) const;
+
+		void Refit(const std::vector<Triangle>&);
+		bool Overlaps(const glm::vec3&, const glm::vec3&) const;
 
-		bool Insert(Triangle);
-		bool Insert(std::vector<Triangle>);
+		size_t MemoryUsage() const;
 
 	private:
+		friend class CompressedOctree; // flattens octrees into its own layout
+
 		float xMin, xMax;
 		float yMin, yMax;
 		float zMin, zMax;
+		unsigned int depth;
+
+		// tight bounds around every triangle in this node and its sub-octrees
+		glm::vec3 boundsMin, boundsMax;
 
 		std::vector<Octree> subOctrees;
 		bool subdivided;
 
-		std::vector<Triangle> octreeTris;
+		std::vector<unsigned int> octreeTris;
+
+		bool fits(const glm::vec3&, const glm::vec3&) const;
+		void subdivide(const std::vector<Triangle>&);
+		unsigned int childFor(const glm::vec3&, const glm::vec3&) const;
 };
 
+void triangleBounds(const Triangle&, glm::vec3&, glm::vec3&);
+
 #endif
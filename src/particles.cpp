@@ -0,0 +1,239 @@
+// particles.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <algorithm> // for min, max
+using namespace std;
+
+// our files
+#include "particles.h" // for ParticleSystem declaration
+#include "shapes.h" // for Triangle class
+#include "shader.h" // for Shader class
+#include "physics.h" // for PhysicsWorld class
+#include "utils.h" // for RayIntersectsTriangle
+#include "glhandles.h" // for streamBuffer
+
+// ParticleSystem Constructor
+ParticleSystem::ParticleSystem(unsigned int maxParticles, glm::vec3 gravity, float drag, float bounce, glm::vec3 colour) : maxParticles(maxParticles), count(0), drawReady(false) {
+	Gravity = gravity;
+	Drag = drag;
+	Bounce = bounce;
+	Colour = colour;
+
+	vector<float>* arrays[] = {&posX, &posY, &posZ, &velX, &velY, &velZ, &life, &size, &prevX, &prevY, &prevZ};
+	for (unsigned int i = 0; i < sizeof(arrays) / sizeof(arrays[0]); ++i) {
+		arrays[i]->resize(maxParticles);
+	}
+}
+
+// Adds a particle with the given position, velocity (per second), lifetime (in seconds) and
+// size. Returns false if the system is already full.
+bool ParticleSystem::Emit(const glm::vec3 &position, const glm::vec3 &velocity, float lifetime, float particleSize) {
+	if (count >= maxParticles)
+		return false;
+
+	posX[count] = position.x;
+	posY[count] = position.y;
+	posZ[count] = position.z;
+	velX[count] = velocity.x;
+	velY[count] = velocity.y;
+	velZ[count] = velocity.z;
+	life[count] = lifetime;
+	size[count] = particleSize;
+	++count;
+	return true;
+}
+
+// Moves every particle through dt seconds, bouncing them off the world's level geometry
+// if a world is given, and removes the ones that have run out of life
+void ParticleSystem::Update(float dt, PhysicsWorld *world) {
+	if (world) {
+		copy(posX.begin(), posX.begin() + count, prevX.begin());
+		copy(posY.begin(), posY.begin() + count, prevY.begin());
+		copy(posZ.begin(), posZ.begin() + count, prevZ.begin());
+	}
+
+	integrate(dt);
+
+	if (world)
+		collide(*world);
+
+	removeDead();
+}
+
+// Applies gravity and drag, and moves the particles. Each loop only touches one or two
+// arrays, with nothing in the way of the compiler vectorizing it.
+void ParticleSystem::integrate(float dt) {
+	float *__restrict px = posX.data(), *__restrict py = posY.data(), *__restrict pz = posZ.data();
+	float *__restrict vx = velX.data(), *__restrict vy = velY.data(), *__restrict vz = velZ.data();
+	float *__restrict l = life.data();
+	float keep = max(0.0f, 1.0f - Drag * dt);
+	glm::vec3 dv = Gravity * dt;
+
+	for (unsigned int i = 0; i < count; ++i)
+		vx[i] = (vx[i] + dv.x) * keep;
+	for (unsigned int i = 0; i < count; ++i)
+		vy[i] = (vy[i] + dv.y) * keep;
+	for (unsigned int i = 0; i < count; ++i)
+		vz[i] = (vz[i] + dv.z) * keep;
+
+	for (unsigned int i = 0; i < count; ++i)
+		px[i] += vx[i] * dt;
+	for (unsigned int i = 0; i < count; ++i)
+		py[i] += vy[i] * dt;
+	for (unsigned int i = 0; i < count; ++i)
+		pz[i] += vz[i] * dt;
+
+	for (unsigned int i = 0; i < count; ++i)
+		l[i] -= dt;
+}
+
+// Checks the path each particle took this update against the level. A particle that
+// crossed a triangle's front face gets put back just in front of it, with its velocity
+// bounced off it.
+void ParticleSystem::collide(PhysicsWorld &world) {
+	const float NUDGE = 0.001f; // how far in front of a surface a bounced particle is left
+
+	for (unsigned int i = 0; i < count; ++i) {
+		glm::vec3 from(prevX[i], prevY[i], prevZ[i]);
+		glm::vec3 to(posX[i], posY[i], posZ[i]);
+		glm::vec3 path = to - from;
+
+		candidates.clear();
+		world.QueryStatic(glm::min(from, to), glm::max(from, to), candidates);
+
+		float hitTime = 1.0f;
+		int hitTri = -1;
+		for (unsigned int j = 0; j < candidates.size(); ++j) {
+			const Triangle &tri = candidates[j];
+			// particles pass through back faces, like bodies do
+			if (glm::dot(tri.Normal, path) >= 0.0f)
+				continue;
+
+			float t;
+			if (RayIntersectsTriangle(from, path, tri.Vertices[0], tri.Vertices[1], tri.Vertices[2], t) && t <= hitTime) {
+				hitTime = t;
+				hitTri = j;
+			}
+		}
+		if (hitTri < 0)
+			continue;
+
+		const glm::vec3 &normal = candidates[hitTri].Normal;
+		glm::vec3 hit = from + path * hitTime + normal * NUDGE;
+		glm::vec3 velocity(velX[i], velY[i], velZ[i]);
+		velocity -= (1.0f + Bounce) * glm::dot(velocity, normal) * normal;
+
+		posX[i] = hit.x;
+		posY[i] = hit.y;
+		posZ[i] = hit.z;
+		velX[i] = velocity.x;
+		velY[i] = velocity.y;
+		velZ[i] = velocity.z;
+	}
+}
+
+// Removes every particle with no life left, keeping the arrays packed
+void ParticleSystem::removeDead() {
+	for (unsigned int i = 0; i < count;) {
+		if (life[i] <= 0.0f)
+			kill(i);
+		else
+			++i;
+	}
+}
+
+// Removes a particle by moving the last one into its place
+void ParticleSystem::kill(unsigned int index) {
+	--count;
+	posX[index] = posX[count];
+	posY[index] = posY[count];
+	posZ[index] = posZ[count];
+	velX[index] = velX[count];
+	velY[index] = velY[count];
+	velZ[index] = velZ[count];
+	life[index] = life[count];
+	size[index] = size[count];
+}
+
+// Renders every particle as a camera-facing quad, in a single instanced draw call
+void ParticleSystem::Draw(Shader &shader) {
+	if (!drawReady)
+		setupDraw();
+	if (count == 0)
+		return;
+
+	instanceData.resize(count * 4);
+	for (unsigned int i = 0; i < count; ++i) {
+		instanceData[i * 4 + 0] = posX[i];
+		instanceData[i * 4 + 1] = posY[i];
+		instanceData[i * 4 + 2] = posZ[i];
+		instanceData[i * 4 + 3] = size[i];
+	}
+
+	streamBuffer(GL_ARRAY_BUFFER, instanceVBO, maxParticles * 4 * sizeof(float), count * 4 * sizeof(float), instanceData.data());
+
+	// the view and projection come from the camera's uniform buffer
+	shader.use();
+	shader.setVec3("ParticleColor", Colour);
+
+	glBindVertexArray(VAO);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+	glBindVertexArray(0);
+}
+
+// Sets up the quad every particle is drawn as, and the buffer of per-particle data
+void ParticleSystem::setupDraw() {
+	float corners[] = {
+		-1.0f, -1.0f,
+		 1.0f, -1.0f,
+		-1.0f,  1.0f,
+		 1.0f,  1.0f
+	};
+
+	VAO = VertexArrayHandle::Create();
+	quadVBO = BufferHandle::Create();
+	instanceVBO = BufferHandle::Create();
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+	// position and size, once per particle instead of once per corner
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, maxParticles * 4 * sizeof(float), NULL, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+	drawReady = true;
+}
+
+// Gets the number of live particles
+unsigned int ParticleSystem::NumParticles() const {
+	return count;
+}
+
+// Gets the most particles the system can hold at once
+unsigned int ParticleSystem::MaxParticles() const {
+	return maxParticles;
+}
+
+// Gets a live particle's position. Particles get moved around as others die, so an index
+// only means the same particle until the next Update.
+glm::vec3 ParticleSystem::GetPosition(unsigned int index) const {
+	return glm::vec3(posX[index], posY[index], posZ[index]);
+}
+
+// Gets a live particle's velocity
+glm::vec3 ParticleSystem::GetVelocity(unsigned int index) const {
+	return glm::vec3(velX[index], velY[index], velZ[index]);
+}
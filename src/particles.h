@@ -0,0 +1,74 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+// particles.h
+// Defines the ParticleSystem class, used for lots of small short-lived things (sparks, debris,
+// rain) that are too cheap to be worth a Thing each.
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+
+// our files
+#include "shapes.h" // for Triangle class
+#include "shader.h" // for Shader class
+#include "physics.h" // for PhysicsWorld class
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle
+
+const unsigned int MAX_PARTICLES = 10000;
+const glm::vec3 PARTICLE_GRAVITY = GRAVITY / (TICK_LENGTH * TICK_LENGTH); // GRAVITY, but per second squared
+const float PARTICLE_DRAG = 0.1f; // fraction of its velocity a particle loses per second
+const float PARTICLE_BOUNCE = 0.4f; // fraction of its speed into a surface a particle keeps on bouncing off it
+const glm::vec3 PARTICLE_COLOUR = glm::vec3(1.0f, 0.7f, 0.2f);
+
+// ParticleSystem class
+// Particles are stored as separate arrays per component (structure of arrays), so moving
+// them is a few straight loops over floats that the compiler can vectorize. They collide
+// with the level as points, and are drawn all at once as instanced quads.
+class ParticleSystem {
+	public:
+		glm::vec3 Gravity;
+		float Drag;
+		float Bounce;
+		glm::vec3 Colour;
+
+		ParticleSystem(unsigned int = MAX_PARTICLES, glm::vec3 = PARTICLE_GRAVITY, float = PARTICLE_DRAG, float = PARTICLE_BOUNCE, glm::vec3 = PARTICLE_COLOUR);
+
+		bool Emit(const glm::vec3&, const glm::vec3&, float, float);
+		void Update(float, PhysicsWorld* = NULL);
+		void Draw(Shader&);
+
+		unsigned int NumParticles() const;
+		unsigned int MaxParticles() const;
+		glm::vec3 GetPosition(unsigned int) const;
+		glm::vec3 GetVelocity(unsigned int) const;
+
+	private:
+		unsigned int maxParticles;
+		unsigned int count;
+		std::vector<float> posX, posY, posZ;
+		std::vector<float> velX, velY, velZ;
+		std::vector<float> life; // seconds left
+		std::vector<float> size; // half the width of the quad it's drawn as
+
+		// scratch space for collisions, kept around so updates don't allocate
+		std::vector<float> prevX, prevY, prevZ;
+		std::vector<Triangle> candidates;
+
+		// drawing is only set up the first time it's needed, so particles can be simulated
+		// without a gl context
+		bool drawReady;
+		VertexArrayHandle VAO;
+		BufferHandle quadVBO, instanceVBO;
+		std::vector<float> instanceData; // x, y, z, size per particle
+
+		void integrate(float);
+		void collide(PhysicsWorld&);
+		void removeDead();
+		void kill(unsigned int);
+		void setupDraw();
+};
+
+#endif
@@ -0,0 +1,528 @@
+// physics.cpp
+
+// libraries
+#include <glm/glm.hpp> // gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <algorithm> // for sort, stable_sort, min, max
+#include <cmath> // for ceil
+using namespace std;
+
+// our files
+#include "physics.h" // for PhysicsWorld declaration
+#include "shapes.h" // for Ellipsoid and Triangle classes
+#include "octree.h" // for Octree class
+#include "collision.h" // for collision utilities
+#include "utils.h" // for mortonOrder
+#include "physicsstats.h" // for stats macros
+
+// KinematicMesh Constructor
+KinematicMesh::KinematicMesh(const vector<Triangle> &localTris, const glm::mat4 &transform) : LocalTris(localTris), Index(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f) {
+	WorldTris.reserve(LocalTris.size());
+	for (unsigned int i = 0; i < LocalTris.size(); ++i) {
+		const Triangle &tri = LocalTris[i];
+		WorldTris.push_back(Triangle(
+			glm::vec3(transform * glm::vec4(tri.Vertices[0], 1.0f)),
+			glm::vec3(transform * glm::vec4(tri.Vertices[1], 1.0f)),
+			glm::vec3(transform * glm::vec4(tri.Vertices[2], 1.0f))));
+	}
+	Index = Octree(WorldTris);
+
+	Transform = transform;
+	Applied = transform;
+	Delta = glm::mat4(1.0f);
+	Moved = false;
+}
+
+// PhysicsWorld Constructor
+PhysicsWorld::PhysicsWorld(glm::vec3 gravity, float damping, float tickLength, bool spatialSort, unsigned int sortInterval, bool compressStatic) : staticIndex(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f), compressed(false) {
+	Gravity = gravity;
+	Damping = damping;
+	TickLength = tickLength;
+	SpatialSort = spatialSort;
+	SortInterval = sortInterval;
+	CompressStatic = compressStatic;
+	SubstepRatio = SUBSTEP_RATIO;
+	MaxSubsteps = MAX_SUBSTEPS;
+	SubstepBudget = SUBSTEP_BUDGET;
+	InactiveInterval = INACTIVE_INTERVAL;
+	substepReport = SubstepReport{0, 0, 0, 0, 0};
+	ticksSinceSort = 0;
+	accumulator = 0.0f;
+}
+
+// Replaces the level geometry, and rebuilds the index used to look it up
+void PhysicsWorld::SetStaticGeometry(const vector<Triangle> &tris) {
+	staticTris.clear();
+	staticTriIDs.clear();
+
+	if (SpatialSort) {
+		vector<glm::vec3> centroids;
+		centroids.reserve(tris.size());
+		for (unsigned int i = 0; i < tris.size(); ++i) {
+			centroids.push_back((tris[i].Vertices[0] + tris[i].Vertices[1] + tris[i].Vertices[2]) / 3.0f);
+		}
+		staticTriIDs = mortonOrder(centroids);
+	}
+	else {
+		for (unsigned int i = 0; i < tris.size(); ++i) {
+			staticTriIDs.push_back(i);
+		}
+	}
+
+	staticTris.reserve(tris.size());
+	for (unsigned int i = 0; i < staticTriIDs.size(); ++i) {
+		staticTris.push_back(tris[staticTriIDs[i]]);
+	}
+
+	compressed = CompressStatic;
+	if (compressed) {
+		// the compressed tree keeps its own copy, so the full-float one can go
+		compressedIndex = CompressedOctree(staticTris);
+		staticIndex = Octree(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+		vector<Triangle>().swap(staticTris);
+	}
+	else {
+		compressedIndex = CompressedOctree();
+		staticIndex = Octree(staticTris);
+	}
+}
+
+// Gets the level geometry, in the order it's stored in. Empty if it's compressed.
+const vector<Triangle>& PhysicsWorld::GetStaticGeometry() const {
+	return staticTris;
+}
+
+// Gets the number of level triangles
+unsigned int PhysicsWorld::NumStaticTriangles() const {
+	return staticTriIDs.size();
+}
+
+// Gets the index a stored triangle had in the vector given to SetStaticGeometry
+unsigned int PhysicsWorld::StaticTriangleID(unsigned int index) const {
+	if (compressed)
+		return staticTriIDs[compressedIndex.TriangleID(index)];
+	return staticTriIDs[index];
+}
+
+// Finds how many bytes the level geometry and its index take up
+size_t PhysicsWorld::StaticMemoryUsage() const {
+	size_t bytes = staticTriIDs.capacity() * sizeof(unsigned int);
+	if (compressed)
+		return bytes + compressedIndex.MemoryUsage();
+	return bytes + staticTris.capacity() * sizeof(Triangle) + staticIndex.MemoryUsage();
+}
+
+// Finds how many bytes the level geometry and its index take up per triangle
+float PhysicsWorld::StaticBytesPerTriangle() const {
+	if (staticTriIDs.empty())
+		return 0.0f;
+	return (float)StaticMemoryUsage() / (float)staticTriIDs.size();
+}
+
+// Adds geometry that can be moved around later, given in its own local space. Returns the
+// ID to move it with.
+unsigned int PhysicsWorld::AddKinematicGeometry(const vector<Triangle> &localTris, const glm::mat4 &transform) {
+	kinematics.push_back(KinematicMesh(localTris, transform));
+	return kinematics.size() - 1;
+}
+
+// Moves kinematic geometry. Takes effect on the next tick.
+void PhysicsWorld::SetKinematicTransform(unsigned int id, const glm::mat4 &transform) {
+	kinematics[id].Transform = transform;
+}
+
+// Gets kinematic geometry, in world space
+const vector<Triangle>& PhysicsWorld::GetKinematicGeometry(unsigned int id) const {
+	return kinematics[id].WorldTris;
+}
+
+// Gets the number of kinematic meshes
+unsigned int PhysicsWorld::NumKinematicMeshes() const {
+	return kinematics.size();
+}
+
+// Adds a body to the world, returning the ID to look it up with later.
+// IDs stay valid even when the bodies get re-sorted.
+unsigned int PhysicsWorld::AddBody(const Ellipsoid &body) {
+	unsigned int id = bodySlots.size();
+	bodySlots.push_back(bodies.size());
+	bodyIDs.push_back(id);
+	bodies.push_back(body);
+	contacts.push_back(KinematicContact{-1, glm::vec3(0.0f)});
+	active.push_back(1);
+	idleTicks.push_back(0);
+	return id;
+}
+
+// Gets a body by its ID
+Ellipsoid& PhysicsWorld::GetBody(unsigned int id) {
+	return bodies[bodySlots[id]];
+}
+const Ellipsoid& PhysicsWorld::GetBody(unsigned int id) const {
+	return bodies[bodySlots[id]];
+}
+
+// Gets the number of bodies in the world
+unsigned int PhysicsWorld::NumBodies() const {
+	return bodies.size();
+}
+
+// Sets whether a body is simulated every tick. Inactive bodies, for things nobody can see,
+// are stepped less often, in bigger steps. A body that's made active again catches up on
+// whatever ticks it skipped the next time it's stepped.
+void PhysicsWorld::SetBodyActive(unsigned int id, bool isActive) {
+	active[bodySlots[id]] = isActive;
+}
+
+// Checks whether a body is simulated
+bool PhysicsWorld::BodyActive(unsigned int id) const {
+	return active[bodySlots[id]] != 0;
+}
+
+// Gets the number of bodies being simulated
+unsigned int PhysicsWorld::NumActiveBodies() const {
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < active.size(); ++i)
+		count += active[i];
+	return count;
+}
+
+// Advances the world by dt seconds, in whole ticks. Leftover time carries over to the next
+// call, so the simulation runs at the same speed no matter the framerate.
+// Returns the number of ticks run.
+unsigned int PhysicsWorld::Step(float dt) {
+	PHYSICS_BEGIN_FRAME();
+	substepReport = SubstepReport{0, 0, 0, 0, 0};
+	unsigned int ticks = 0;
+	{
+		PHYSICS_TIMER(STAGE_STEP);
+		ticks = runTicks(dt);
+	}
+	PHYSICS_COUNT(Ticks, ticks);
+	PHYSICS_END_FRAME();
+
+	return ticks;
+}
+
+// Runs as many whole ticks as dt (plus the leftover time) covers
+unsigned int PhysicsWorld::runTicks(float dt) {
+	accumulator += dt;
+
+	unsigned int ticks = 0;
+	while (accumulator >= TickLength && ticks < MAX_TICKS_PER_STEP) {
+		tick();
+		accumulator -= TickLength;
+		++ticks;
+	}
+
+	// dropping whatever we couldn't catch up on
+	if (ticks >= MAX_TICKS_PER_STEP)
+		accumulator = 0.0f;
+
+	return ticks;
+}
+
+// Appends every level triangle that could be inside the given box, in whichever form the
+// level is stored. Used by things that collide with the level without being bodies.
+void PhysicsWorld::QueryStatic(const glm::vec3 &queryMin, const glm::vec3 &queryMax, vector<Triangle> &out) {
+	if (compressed) {
+		compressedIndex.Query(queryMin, queryMax, out);
+		return;
+	}
+
+	candidateIndices.clear();
+	staticIndex.Query(staticTris, queryMin, queryMax, candidateIndices);
+	for (unsigned int i = 0; i < candidateIndices.size(); ++i) {
+		out.push_back(staticTris[candidateIndices[i]]);
+	}
+}
+
+// Gets how the substep budget was spent over the last Step
+const SubstepReport& PhysicsWorld::GetSubstepReport() const {
+	return substepReport;
+}
+
+// Reorders the body array along a Z-order curve through the bodies' positions, keeping
+// every body's ID the same
+void PhysicsWorld::SortBodies() {
+	vector<glm::vec3> positions;
+	positions.reserve(bodies.size());
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		positions.push_back(bodies[i].Position);
+	}
+	vector<unsigned int> order = mortonOrder(positions);
+
+	vector<Ellipsoid> sortedBodies;
+	vector<unsigned int> sortedIDs;
+	vector<KinematicContact> sortedContacts;
+	vector<unsigned char> sortedActive;
+	vector<unsigned int> sortedIdle;
+	sortedBodies.reserve(bodies.size());
+	sortedIDs.reserve(bodies.size());
+	sortedContacts.reserve(bodies.size());
+	sortedActive.reserve(bodies.size());
+	sortedIdle.reserve(bodies.size());
+	for (unsigned int i = 0; i < order.size(); ++i) {
+		sortedBodies.push_back(bodies[order[i]]);
+		sortedIDs.push_back(bodyIDs[order[i]]);
+		sortedContacts.push_back(contacts[order[i]]);
+		sortedActive.push_back(active[order[i]]);
+		sortedIdle.push_back(idleTicks[order[i]]);
+		bodySlots[sortedIDs[i]] = i;
+	}
+	bodies.swap(sortedBodies);
+	bodyIDs.swap(sortedIDs);
+	contacts.swap(sortedContacts);
+	active.swap(sortedActive);
+	idleTicks.swap(sortedIdle);
+}
+
+// Moves every body through a single tick
+void PhysicsWorld::tick() {
+	if (SpatialSort && SortInterval > 0 && ++ticksSinceSort >= SortInterval) {
+		SortBodies();
+		ticksSinceSort = 0;
+	}
+
+	moveKinematics();
+	planSubsteps();
+
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		if (stepTicks[i] > 0)
+			stepBody(i);
+	}
+}
+
+// Works out which bodies are stepped this tick, and how many substeps each takes. Active
+// bodies, and bodies riding kinematic geometry, are stepped every tick. Other inactive ones
+// are stepped once they've skipped enough ticks. Each body wants enough substeps that it
+// moves at most SubstepRatio of its smallest radius per substep. If all of them together
+// want more than the budget, each gets its share of the budget in proportion to how many
+// extra it wanted, with the shares rounded so the whole budget gets used.
+void PhysicsWorld::planSubsteps() {
+	substeps.resize(bodies.size());
+	stepTicks.resize(bodies.size());
+
+	unsigned int requested = 0;
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		const Ellipsoid &body = bodies[i];
+		substeps[i] = 1;
+
+		// the carry only covers the platform's last tick, so a body riding one can't skip any
+		if (!active[i] && contacts[i].Mesh < 0 && idleTicks[i] + 1 < InactiveInterval) {
+			++idleTicks[i];
+			stepTicks[i] = 0;
+			continue;
+		}
+		stepTicks[i] = idleTicks[i] + 1;
+		idleTicks[i] = 0;
+
+		float radius = min(body.Radii.x, min(body.Radii.y, body.Radii.z));
+		float wanted = ceil(glm::length(body.Velocity) * stepTicks[i] / (SubstepRatio * radius));
+		substeps[i] = (unsigned int)max(1.0f, min(wanted, (float)MaxSubsteps));
+		requested += substeps[i] - 1;
+	}
+
+	if (requested > SubstepBudget) {
+		// every share's rounded down first, and what that leaves over goes one each to the
+		// bodies that lost the most to rounding (so 300 bodies wanting one each out of 256
+		// doesn't give all of them none)
+		substepRemainders.resize(bodies.size());
+		substepOrder.clear();
+		unsigned int shared = 0;
+		for (unsigned int i = 0; i < bodies.size(); ++i) {
+			unsigned long long share = (unsigned long long)(substeps[i] - 1) * SubstepBudget;
+			substeps[i] = 1 + (unsigned int)(share / requested);
+			substepRemainders[i] = (unsigned int)(share % requested);
+			shared += substeps[i] - 1;
+			if (substepRemainders[i] > 0)
+				substepOrder.push_back(i);
+		}
+
+		stable_sort(substepOrder.begin(), substepOrder.end(), [this](unsigned int a, unsigned int b) { return substepRemainders[a] > substepRemainders[b]; });
+		for (unsigned int i = 0; i < substepOrder.size() && shared < SubstepBudget; ++i) {
+			++substeps[substepOrder[i]];
+			++shared;
+		}
+	}
+
+	unsigned int granted = 0;
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		unsigned int extra = substeps[i] - 1;
+		granted += extra;
+		if (extra > 0)
+			++substepReport.Bodies;
+		substepReport.MostSubsteps = max(substepReport.MostSubsteps, substeps[i]);
+	}
+
+	substepReport.Budget += SubstepBudget;
+	substepReport.Requested += requested;
+	substepReport.Granted += granted;
+	PHYSICS_COUNT(Substeps, granted);
+	PHYSICS_COUNT(SubstepsDenied, requested - granted);
+}
+
+// Brings every kinematic mesh whose transform changed up to date. Only the triangles are
+// re-transformed and the octree refit, which is linear in the mesh's size.
+void PhysicsWorld::moveKinematics() {
+	PHYSICS_TIMER(STAGE_KINEMATICS);
+	for (unsigned int i = 0; i < kinematics.size(); ++i) {
+		KinematicMesh &mesh = kinematics[i];
+		mesh.Moved = (mesh.Transform != mesh.Applied);
+		if (!mesh.Moved)
+			continue;
+
+		for (unsigned int j = 0; j < mesh.LocalTris.size(); ++j) {
+			const Triangle &tri = mesh.LocalTris[j];
+			mesh.WorldTris[j] = Triangle(
+				glm::vec3(mesh.Transform * glm::vec4(tri.Vertices[0], 1.0f)),
+				glm::vec3(mesh.Transform * glm::vec4(tri.Vertices[1], 1.0f)),
+				glm::vec3(mesh.Transform * glm::vec4(tri.Vertices[2], 1.0f)));
+		}
+		mesh.Index.Refit(mesh.WorldTris);
+
+		mesh.Delta = mesh.Transform * glm::inverse(mesh.Applied);
+		mesh.Applied = mesh.Transform;
+	}
+}
+
+// Works out how far the kinematic mesh a body touched last tick moves it this tick, if
+// that mesh moved. Bodies standing on it ride along with it completely, and bodies touching
+// it from the side only get pushed out of its way.
+glm::vec3 PhysicsWorld::carryOffset(const Ellipsoid &body, const KinematicContact &contact) const {
+	if (contact.Mesh < 0 || !kinematics[contact.Mesh].Moved)
+		return glm::vec3(0.0f);
+
+	glm::vec3 carried = glm::vec3(kinematics[contact.Mesh].Delta * glm::vec4(body.Position, 1.0f));
+	if (contact.Normal.y >= SUPPORT_NORMAL_Y)
+		return carried - body.Position;
+
+	float push = glm::dot(carried - body.Position, contact.Normal);
+	return (push > 0.0f) ? push * contact.Normal : glm::vec3(0.0f);
+}
+
+// Fills candidates with every triangle a body could reach within the given box: the level
+// geometry first, then the kinematic geometry (noting which mesh each came from). Returns
+// how far off the level triangles it found can be from the real ones.
+float PhysicsWorld::gatherCandidates(const Ellipsoid &body, const glm::vec3 &reach) {
+	PHYSICS_TIMER(STAGE_GATHER);
+	PHYSICS_COUNT(Queries, 1);
+
+	glm::vec3 queryMin = body.Position - reach;
+	glm::vec3 queryMax = body.Position + reach;
+
+	candidates.clear();
+	candidateMeshes.clear();
+	float error = 0.0f;
+
+	if (compressed) {
+		compressedIndex.Query(queryMin, queryMax, candidates, &error);
+	}
+	else {
+		candidateIndices.clear();
+		staticIndex.Query(staticTris, queryMin, queryMax, candidateIndices);
+
+		// keeping candidates in storage order, so ties between equally early hits are broken
+		// the same way as they would be against the whole level
+		sort(candidateIndices.begin(), candidateIndices.end());
+		for (unsigned int i = 0; i < candidateIndices.size(); ++i) {
+			candidates.push_back(staticTris[candidateIndices[i]]);
+		}
+	}
+
+	for (unsigned int i = 0; i < kinematics.size(); ++i) {
+		if (!kinematics[i].Index.Overlaps(queryMin, queryMax))
+			continue;
+
+		candidateIndices.clear();
+		kinematics[i].Index.Query(kinematics[i].WorldTris, queryMin, queryMax, candidateIndices);
+		for (unsigned int j = 0; j < candidateIndices.size(); ++j) {
+			candidates.push_back(kinematics[i].WorldTris[candidateIndices[j]]);
+			candidateMeshes.push_back(i);
+		}
+	}
+
+	PHYSICS_COUNT(Candidates, candidates.size());
+	return error;
+}
+
+// Moves one body through as many ticks as it's stepped for this tick (just the one for
+// active bodies): collides it with the level, then applies gravity and damping
+void PhysicsWorld::stepBody(unsigned int slot) {
+	Ellipsoid &body = bodies[slot];
+	KinematicContact &contact = contacts[slot];
+	float ticks = (float)stepTicks[slot];
+
+	glm::vec3 carry = carryOffset(body, contact);
+
+	// picking up any changes to the body's radii or orientation, once for the whole tick
+	body.UpdateColliderSpace();
+
+	// the body can't get further than its speed (and whatever it's carried) this tick, even
+	// after sliding, so anything outside of that box can't be hit
+	glm::vec3 reach = body.Extents() + glm::vec3(glm::length(body.Velocity) * ticks + glm::length(carry));
+
+	// quantized vertices can be off by up to the max error, so the query reaches that much
+	// further to be sure it finds everything. the body then gets extra skin for only as much
+	// error as the triangles it found can have, so it never slips through a gap the real
+	// level doesn't have, without bodies in finely quantized spots paying for the worst one.
+	if (compressed)
+		reach += glm::vec3(compressedIndex.MaxVertexError());
+
+	float skin = gatherCandidates(body, reach);
+	unsigned int numStatic = candidates.size() - candidateMeshes.size();
+
+	hits.clear();
+	{
+		PHYSICS_TIMER(STAGE_SWEEP);
+
+		// the carry's swept against the level first, so a platform can't shove the body
+		// into a wall or ceiling. the platform's already moved, so it isn't swept against.
+		if (carry != glm::vec3(0.0f)) {
+			staticCandidates.assign(candidates.begin(), candidates.begin() + numStatic);
+			Ellipsoid carried(body.Radii + glm::vec3(skin), body.Position, carry, body.Orientation);
+			if (carried.Shape != UNIT_SPHERE)
+				toColliderSpace(carried, staticCandidates, colliderCandidates);
+			handleColliderIntersection(carried, (carried.Shape == UNIT_SPHERE) ? staticCandidates : colliderCandidates);
+			body.Position = carried.Position;
+		}
+
+		// each substep covers an even share of the tick. the candidates still cover the
+		// whole tick, so they only need gathering (and moving into collider space) once.
+		float count = (float)substeps[slot];
+		Ellipsoid swept(body.Radii + glm::vec3(skin), body.Position, body.Velocity * ticks / count, body.Orientation);
+		if (swept.Shape != UNIT_SPHERE)
+			toColliderSpace(swept, candidates, colliderCandidates);
+		const vector<Triangle> &sweptCandidates = (swept.Shape == UNIT_SPHERE) ? candidates : colliderCandidates;
+
+		for (unsigned int i = 0; i < substeps[slot]; ++i) {
+			handleColliderIntersection(swept, sweptCandidates, &hits);
+		}
+		body.Position = swept.Position;
+		body.Velocity = swept.Velocity * count / ticks;
+	}
+
+	// remembering the most ground-like kinematic mesh the body slid along
+	bool wasCarried = contact.Mesh >= 0;
+	contact.Mesh = -1;
+	for (unsigned int i = 0; i < hits.size(); ++i) {
+		if (hits[i].Index < numStatic)
+			continue;
+		if (contact.Mesh < 0 || hits[i].Normal.y > contact.Normal.y) {
+			contact.Mesh = candidateMeshes[hits[i].Index - numStatic];
+			contact.Normal = hits[i].Normal;
+		}
+	}
+
+	// a body leaving a moving mesh keeps the mesh's velocity, instead of stopping dead in
+	// the air
+	if (wasCarried && contact.Mesh < 0)
+		body.Velocity += carry;
+
+	for (unsigned int i = 0; i < stepTicks[slot]; ++i) {
+		body.Velocity += Gravity;
+		body.Velocity *= Damping;
+	}
+}
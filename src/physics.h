@@ -0,0 +1,160 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+// physics.h
+// Defines the PhysicsWorld class, which owns level geometry and bodies, and steps them.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <cstddef> // for size_t
+
+// our files
+#include "shapes.h" // for Ellipsoid and Triangle classes
+#include "octree.h" // for Octree class
+#include "compressedoctree.h" // for CompressedOctree class
+#include "collision.h" // for CollisionHit
+
+// velocities are in units per tick, so these are per tick as well
+const glm::vec3 GRAVITY = glm::vec3(0.0f, -0.001f, 0.0f);
+const float DAMPING = 0.99f;
+const float TICK_LENGTH = 1.0f / 60.0f;
+const unsigned int MAX_TICKS_PER_STEP = 5; // keeps a long frame from snowballing
+const bool SPATIAL_SORT = true;
+const unsigned int SORT_INTERVAL = 60; // ticks between re-sorting bodies, 0 for never
+const bool COMPRESS_STATIC = false;
+const float SUPPORT_NORMAL_Y = 0.7f; // contacts with normals at least this upright are ground
+const float SUBSTEP_RATIO = 0.5f; // how much of its smallest radius a body may move per substep
+const unsigned int MAX_SUBSTEPS = 8; // most substeps one body takes in a tick
+const unsigned int SUBSTEP_BUDGET = 256; // extra substeps per tick, shared by every body
+const unsigned int INACTIVE_INTERVAL = 4; // ticks between steps of bodies nobody can see
+
+// Level geometry that moves as a whole (moving platforms, doors). Its triangles are kept in
+// local space and re-transformed whenever the transform changes, with the octree refit
+// instead of rebuilt.
+struct KinematicMesh {
+	std::vector<Triangle> LocalTris;
+	std::vector<Triangle> WorldTris;
+	Octree Index;
+
+	glm::mat4 Transform; // the transform asked for
+	glm::mat4 Applied; // the transform WorldTris are currently in
+	glm::mat4 Delta; // how it moved this tick
+	bool Moved;
+
+	KinematicMesh(const std::vector<Triangle>&, const glm::mat4&);
+};
+
+// The kinematic mesh a body last slid along, so it can be carried by it next tick
+struct KinematicContact {
+	int Mesh; // -1 for none
+	glm::vec3 Normal;
+};
+
+// How the substep budget was spent over the last Step
+struct SubstepReport {
+	unsigned int Budget; // extra substeps that were available
+	unsigned int Requested; // extra substeps bodies wanted
+	unsigned int Granted; // extra substeps bodies got
+	unsigned int Bodies; // times a body got at least one extra substep
+	unsigned int MostSubsteps; // most substeps any one body took in a tick
+};
+
+class PhysicsWorld {
+	public:
+		glm::vec3 Gravity;
+		float Damping;
+		float TickLength;
+
+		// whether triangles and bodies are kept in Z-order (Morton) so that things close
+		// together in space are close together in memory
+		bool SpatialSort;
+		unsigned int SortInterval;
+
+		// whether level geometry is kept in a CompressedOctree instead of full floats.
+		// only takes effect on the next SetStaticGeometry.
+		bool CompressStatic;
+
+		// fast bodies are swept in several smaller substeps, so they can't skip over
+		// anything or run out of sliding passes. the budget is split between the bodies
+		// that want them each tick, with resting bodies taking none.
+		float SubstepRatio;
+		unsigned int MaxSubsteps;
+		unsigned int SubstepBudget;
+
+		// inactive bodies are only stepped once every InactiveInterval ticks, covering all
+		// the ticks they skipped at once (unless they're riding kinematic geometry)
+		unsigned int InactiveInterval;
+
+		PhysicsWorld(glm::vec3 = GRAVITY, float = DAMPING, float = TICK_LENGTH, bool = SPATIAL_SORT, unsigned int = SORT_INTERVAL, bool = COMPRESS_STATIC);
+
+		void SetStaticGeometry(const std::vector<Triangle>&);
+		const std::vector<Triangle>& GetStaticGeometry() const;
+		unsigned int NumStaticTriangles() const;
+		unsigned int StaticTriangleID(unsigned int) const;
+		size_t StaticMemoryUsage() const;
+		float StaticBytesPerTriangle() const;
+		void QueryStatic(const glm::vec3&, const glm::vec3&, std::vector<Triangle>&);
+
+		unsigned int AddKinematicGeometry(const std::vector<Triangle>&, const glm::mat4& = glm::mat4(1.0f));
+		void SetKinematicTransform(unsigned int, const glm::mat4&);
+		const std::vector<Triangle>& GetKinematicGeometry(unsigned int) const;
+		unsigned int NumKinematicMeshes() const;
+
+		unsigned int AddBody(const Ellipsoid&);
+		Ellipsoid& GetBody(unsigned int);
+		const Ellipsoid& GetBody(unsigned int) const;
+		unsigned int NumBodies() const;
+		void SetBodyActive(unsigned int, bool);
+		bool BodyActive(unsigned int) const;
+		unsigned int NumActiveBodies() const;
+		void SortBodies();
+
+		unsigned int Step(float);
+		const SubstepReport& GetSubstepReport() const;
+
+	private:
+		std::vector<Triangle> staticTris;
+		std::vector<unsigned int> staticTriIDs; // original index of each stored triangle
+		Octree staticIndex;
+		CompressedOctree compressedIndex;
+		bool compressed;
+
+		std::vector<KinematicMesh> kinematics;
+
+		// bodies are stored in whatever order is best for stepping them, so IDs are mapped
+		// to and from their slots in the body array
+		std::vector<Ellipsoid> bodies;
+		std::vector<unsigned int> bodySlots; // ID -> slot
+		std::vector<unsigned int> bodyIDs; // slot -> ID
+		std::vector<KinematicContact> contacts; // per slot, like bodies
+		std::vector<unsigned char> active; // per slot
+		std::vector<unsigned int> idleTicks; // per slot, ticks skipped since the body was last stepped
+		std::vector<unsigned int> stepTicks; // per slot, ticks each body covers this tick (0 to skip it)
+		std::vector<unsigned int> substeps; // per slot, planned at the start of each tick
+		std::vector<unsigned int> substepRemainders; // per slot, scratch for sharing out the budget
+		std::vector<unsigned int> substepOrder;
+		SubstepReport substepReport;
+		unsigned int ticksSinceSort;
+
+		float accumulator;
+
+		// scratch space for collision candidates, kept around so ticks don't allocate
+		std::vector<unsigned int> candidateIndices;
+		std::vector<Triangle> candidates;
+		std::vector<Triangle> colliderCandidates; // candidates in the current body's collider space
+		std::vector<Triangle> staticCandidates; // just the level candidates, for sweeping carries
+		std::vector<unsigned int> candidateMeshes; // kinematic mesh of each non-static candidate
+		std::vector<CollisionHit> hits;
+
+		unsigned int runTicks(float);
+		void tick();
+		void moveKinematics();
+		void planSubsteps();
+		glm::vec3 carryOffset(const Ellipsoid&, const KinematicContact&) const;
+		float gatherCandidates(const Ellipsoid&, const glm::vec3&);
+		void stepBody(unsigned int);
+};
+
+#endif
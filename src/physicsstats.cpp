@@ -0,0 +1,90 @@
+// physicsstats.cpp
+
+// stdlib
+#include <vector> // for vector
+#include <fstream> // for ofstream
+#include <ostream> // for ostream
+#include <chrono> // for steady_clock
+#include <cstring> // for memset
+using namespace std;
+
+// our files
+#include "physicsstats.h" // for PhysicsStats declaration
+
+PhysicsStats physicsStats;
+
+static const char *STAGE_NAMES[NUM_STAGES] = {"step_ms", "kinematics_ms", "gather_ms", "sweep_ms"};
+
+// PhysicsStats Constructor
+PhysicsStats::PhysicsStats() : nextSlot(0), frame(0) {
+	memset(&Current, 0, sizeof(Current));
+	history.reserve(STATS_HISTORY);
+}
+
+// Starts counting a new frame
+void PhysicsStats::BeginFrame() {
+	memset(&Current, 0, sizeof(Current));
+	Current.Frame = frame++;
+}
+
+// Finishes the current frame, and adds it to the history
+void PhysicsStats::EndFrame() {
+	if (history.size() < STATS_HISTORY) {
+		history.push_back(Current);
+		return;
+	}
+	history[nextSlot] = Current;
+	nextSlot = (nextSlot + 1) % STATS_HISTORY;
+}
+
+// Gets the most recently finished frame
+const PhysicsFrameStats& PhysicsStats::Last() const {
+	if (history.empty())
+		return Current;
+	if (history.size() < STATS_HISTORY)
+		return history.back();
+	return history[(nextSlot + STATS_HISTORY - 1) % STATS_HISTORY];
+}
+
+// Gets the recent frames. Once STATS_HISTORY frames have been kept they are no longer in
+// order, but each one knows its frame number.
+const vector<PhysicsFrameStats>& PhysicsStats::History() const {
+	return history;
+}
+
+// Writes the history out as CSV, oldest frame first
+void PhysicsStats::WriteCSV(ostream &out) const {
+	out << "frame,ticks,queries,candidates,plane_rejects,face_hits,quadratic_tests,quadratic_solves,quadratic_roots,sweeps,passes,pass_cap_hits,substeps,substeps_denied";
+	for (unsigned int i = 0; i < NUM_STAGES; ++i) {
+		out << "," << STAGE_NAMES[i];
+	}
+	out << "\n";
+
+	unsigned int first = (history.size() < STATS_HISTORY) ? 0 : nextSlot;
+	for (unsigned int n = 0; n < history.size(); ++n) {
+		const PhysicsFrameStats &f = history[(first + n) % history.size()];
+		out << f.Frame << "," << f.Ticks << "," << f.Queries << "," << f.Candidates << "," << f.PlaneRejects << "," << f.FaceHits << "," << f.QuadraticTests << "," << f.QuadraticSolves << "," << f.QuadraticRoots << "," << f.Sweeps << "," << f.Passes << "," << f.PassCapHits << "," << f.Substeps << "," << f.SubstepsDenied;
+		for (unsigned int i = 0; i < NUM_STAGES; ++i) {
+			out << "," << f.StageMs[i];
+		}
+		out << "\n";
+	}
+}
+
+// Writes the history out as CSV to a file. Returns whether it could be written.
+bool PhysicsStats::WriteCSV(const char *path) const {
+	ofstream file(path);
+	if (!file)
+		return false;
+	WriteCSV(file);
+	return true;
+}
+
+// ScopedPhysicsTimer Constructor
+ScopedPhysicsTimer::ScopedPhysicsTimer(PhysicsStage stage) : stage(stage), start(chrono::steady_clock::now()) {}
+
+// ScopedPhysicsTimer Destructor
+ScopedPhysicsTimer::~ScopedPhysicsTimer() {
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	physicsStats.Current.StageMs[stage] += elapsed.count();
+}
@@ -0,0 +1,90 @@
+#ifndef PHYSICSSTATS_H
+#define PHYSICSSTATS_H
+// physicsstats.h
+// Defines the PhysicsStats class, which collects per-frame collision counters and timings.
+// Everything is compiled out unless PHYSICS_STATS is defined (see the makefile).
+
+// stdlib
+#include <vector> // for vector
+#include <ostream> // for ostream
+#include <chrono> // for steady_clock
+
+const unsigned int STATS_HISTORY = 600; // frames of history kept for dumping
+
+// the parts of a physics step that get timed
+enum PhysicsStage {
+	STAGE_STEP, // all of PhysicsWorld::Step
+	STAGE_KINEMATICS, // moving and refitting kinematic geometry
+	STAGE_GATHER, // collecting collision candidates
+	STAGE_SWEEP, // sweeping bodies against their candidates
+	NUM_STAGES
+};
+
+// everything counted during a single frame
+struct PhysicsFrameStats {
+	unsigned long Frame;
+	unsigned long Ticks;
+	unsigned long Queries; // candidate lookups
+	unsigned long Candidates; // triangles handed to the sweep
+	unsigned long PlaneRejects; // triangles thrown out by the plane test alone
+	unsigned long FaceHits; // triangles hit on their face, skipping the quadratic stage
+	unsigned long QuadraticTests; // triangles that reached the vertex and edge stage
+	unsigned long QuadraticSolves; // quadratics solved in that stage
+	unsigned long QuadraticRoots; // of those, ones with real roots
+	unsigned long Sweeps; // calls to handleIntersection
+	unsigned long Passes; // sliding passes across all sweeps
+	unsigned long PassCapHits; // sweeps that ran out of passes
+	unsigned long Substeps; // extra substeps granted to fast bodies
+	unsigned long SubstepsDenied; // extra substeps wanted past the budget
+	double StageMs[NUM_STAGES];
+};
+
+class PhysicsStats {
+	public:
+		PhysicsFrameStats Current;
+
+		PhysicsStats();
+
+		void BeginFrame();
+		void EndFrame();
+
+		const PhysicsFrameStats& Last() const;
+		const std::vector<PhysicsFrameStats>& History() const;
+
+		void WriteCSV(std::ostream&) const;
+		bool WriteCSV(const char*) const;
+
+	private:
+		std::vector<PhysicsFrameStats> history; // used as a ring buffer once full
+		unsigned int nextSlot;
+		unsigned long frame;
+};
+
+extern PhysicsStats physicsStats;
+
+// Adds its lifetime to a stage's time for the current frame
+class ScopedPhysicsTimer {
+	public:
+		ScopedPhysicsTimer(PhysicsStage);
+		~ScopedPhysicsTimer();
+
+	private:
+		PhysicsStage stage;
+		std::chrono::steady_clock::time_point start;
+};
+
+#ifdef PHYSICS_STATS
+#define PHYSICS_CONCAT_INNER(a, b) a##b
+#define PHYSICS_CONCAT(a, b) PHYSICS_CONCAT_INNER(a, b)
+#define PHYSICS_COUNT(counter, amount) (physicsStats.Current.counter += (amount))
+#define PHYSICS_TIMER(stage) ScopedPhysicsTimer PHYSICS_CONCAT(physicsTimer, __LINE__)(stage)
+#define PHYSICS_BEGIN_FRAME() physicsStats.BeginFrame()
+#define PHYSICS_END_FRAME() physicsStats.EndFrame()
+#else
+#define PHYSICS_COUNT(counter, amount) ((void)0)
+#define PHYSICS_TIMER(stage) ((void)0)
+#define PHYSICS_BEGIN_FRAME() ((void)0)
+#define PHYSICS_END_FRAME() ((void)0)
+#endif
+
+#endif
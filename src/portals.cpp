@@ -0,0 +1,251 @@
+// portals.cpp
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <iostream> // for cout, endl
+#include <fstream> // for ifstream
+#include <sstream> // for istringstream
+#include <string> // for string
+#include <vector> // for vector
+#include <cmath> // for abs
+using namespace std;
+
+// our files
+#include "portals.h" // for CellGraph declaration
+#include "frustum.h" // for frustumPlanes
+
+// Clips a convex polygon to the inside of a plane
+static void clipToPlane(const vector<glm::vec3> &in, const glm::vec4 &plane, vector<glm::vec3> &out) {
+	out.clear();
+	for (unsigned int i = 0; i < in.size(); ++i) {
+		const glm::vec3 &p = in[i], &q = in[(i + 1) % in.size()];
+		float dp = glm::dot(glm::vec3(plane), p) + plane.w;
+		float dq = glm::dot(glm::vec3(plane), q) + plane.w;
+		if (dp >= 0.0f)
+			out.push_back(p);
+		if ((dp >= 0.0f) != (dq >= 0.0f))
+			out.push_back(p + (q - p) * (dp / (dp - dq)));
+	}
+}
+
+// Checks whether two boxes overlap (touching counts)
+static bool boxesOverlap(const glm::vec3 &aMin, const glm::vec3 &aMax, const glm::vec3 &bMin, const glm::vec3 &bMax) {
+	return !(aMin.x > bMax.x || aMax.x < bMin.x ||
+	         aMin.y > bMax.y || aMax.y < bMin.y ||
+	         aMin.z > bMax.z || aMax.z < bMin.z);
+}
+
+// CellGraph Constructor, with no cells
+CellGraph::CellGraph() : eye(0.0f), portalsTested(0) {
+}
+
+// Loads cells and portals from a file. Returns false if it can't be read, leaving the
+// graph empty.
+bool CellGraph::Load(const char *path) {
+	cells.clear();
+	portals.clear();
+
+	ifstream file(path);
+	if (!file)
+		return false;
+
+	string line;
+	unsigned int lineNumber = 0;
+	while (getline(file, line)) {
+		++lineNumber;
+		istringstream words(line);
+		string kind;
+		if (!(words >> kind) || kind[0] == '#')
+			continue;
+
+		if (kind == "cell") {
+			glm::vec3 cellMin, cellMax;
+			if (words >> cellMin.x >> cellMin.y >> cellMin.z >> cellMax.x >> cellMax.y >> cellMax.z) {
+				AddCell(cellMin, cellMax);
+				continue;
+			}
+		}
+		else if (kind == "portal") {
+			unsigned int a, b;
+			vector<glm::vec3> points;
+			glm::vec3 point;
+			if (words >> a >> b) {
+				while (words >> point.x >> point.y >> point.z)
+					points.push_back(point);
+				if (a < cells.size() && b < cells.size() && points.size() >= 3) {
+					AddPortal(a, b, points);
+					continue;
+				}
+			}
+		}
+
+		cout << "ERROR::CELLS::BAD_LINE " << path << ":" << lineNumber << endl;
+		cells.clear();
+		portals.clear();
+		return false;
+	}
+
+	visible.assign(cells.size(), 1);
+	return true;
+}
+
+// Adds a cell, given its box. Returns its index.
+unsigned int CellGraph::AddCell(const glm::vec3 &cellMin, const glm::vec3 &cellMax) {
+	Cell cell;
+	cell.Min = cellMin;
+	cell.Max = cellMax;
+	cells.push_back(cell);
+	visible.push_back(1);
+	return cells.size() - 1;
+}
+
+// Adds a portal between two cells, given its corners in order around it. Returns its index.
+unsigned int CellGraph::AddPortal(unsigned int a, unsigned int b, const vector<glm::vec3> &points) {
+	Portal portal;
+	portal.CellA = a;
+	portal.CellB = b;
+	portal.Points = points;
+	portals.push_back(portal);
+
+	cells[a].Portals.push_back(portals.size() - 1);
+	cells[b].Portals.push_back(portals.size() - 1);
+	return portals.size() - 1;
+}
+
+// Finds the cell a point is in, or -1 if it's in none of them
+int CellGraph::FindCell(const glm::vec3 &point) const {
+	for (unsigned int i = 0; i < cells.size(); ++i) {
+		if (boxesOverlap(point, point, cells[i].Min, cells[i].Max))
+			return i;
+	}
+	return -1;
+}
+
+// Works out which cells can be seen from the camera at eyePosition, looking through
+// projection * view
+void CellGraph::FindVisible(const glm::vec3 &eyePosition, const glm::mat4 &viewProjection) {
+	eye = eyePosition;
+	portalsTested = 0;
+
+	int start = FindCell(eye);
+	if (start < 0) {
+		visible.assign(cells.size(), 1);
+		return;
+	}
+
+	visible.assign(cells.size(), 0);
+	onPath.assign(cells.size(), 0);
+
+	vector<glm::vec4> planes(6);
+	frustumPlanes(viewProjection, planes.data());
+	walk(start, planes, 0);
+}
+
+// Checks whether a cell was seen by the last FindVisible
+bool CellGraph::CellVisible(unsigned int cell) const {
+	return visible[cell] != 0;
+}
+
+// Checks whether the cell a point is in was seen. Points outside every cell always are.
+bool CellGraph::PointVisible(const glm::vec3 &point) const {
+	int cell = FindCell(point);
+	return cell < 0 || visible[cell];
+}
+
+// Checks whether any cell a box overlaps was seen. Boxes outside every cell always are.
+bool CellGraph::BoxVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const {
+	bool inAny = false;
+	for (unsigned int i = 0; i < cells.size(); ++i) {
+		if (!boxesOverlap(boxMin, boxMax, cells[i].Min, cells[i].Max))
+			continue;
+		if (visible[i])
+			return true;
+		inAny = true;
+	}
+	return !inAny;
+}
+
+// Checks whether there are any cells at all
+bool CellGraph::Empty() const {
+	return cells.empty();
+}
+
+// Gets how many cells there are
+unsigned int CellGraph::NumCells() const {
+	return cells.size();
+}
+
+// Gets how many portals there are
+unsigned int CellGraph::NumPortals() const {
+	return portals.size();
+}
+
+// Gets how many cells were seen by the last FindVisible
+unsigned int CellGraph::NumVisibleCells() const {
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < visible.size(); ++i)
+		count += visible[i];
+	return count;
+}
+
+// Gets how many times a portal was clipped against the view in the last FindVisible
+unsigned int CellGraph::NumPortalsTested() const {
+	return portalsTested;
+}
+
+// Marks a cell visible, then walks into each neighbour whose portal can be seen through
+// the given planes
+void CellGraph::walk(unsigned int cell, const vector<glm::vec4> &planes, unsigned int depth) {
+	visible[cell] = 1;
+	if (depth >= MAX_PORTAL_DEPTH)
+		return;
+
+	onPath[cell] = 1;
+	vector<glm::vec3> clipped, scratch;
+	for (unsigned int i = 0; i < cells[cell].Portals.size(); ++i) {
+		const Portal &portal = portals[cells[cell].Portals[i]];
+		unsigned int next = (portal.CellA == cell) ? portal.CellB : portal.CellA;
+		if (onPath[next])
+			continue;
+		++portalsTested;
+
+		clipped = portal.Points;
+		for (unsigned int p = 0; p < planes.size() && clipped.size() >= 3; ++p) {
+			clipToPlane(clipped, planes[p], scratch);
+			clipped.swap(scratch);
+		}
+		if (clipped.size() < 3)
+			continue;
+
+		// right up against the portal, the planes through it get unreliable, so the view
+		// just carries on through as it is
+		glm::vec3 normal = glm::cross(portal.Points[1] - portal.Points[0], portal.Points[2] - portal.Points[0]);
+		float eyeDistance = glm::dot(normal, eye - portal.Points[0]) / glm::length(normal);
+		if (abs(eyeDistance) < PORTAL_NEAR) {
+			walk(next, planes, depth + 1);
+			continue;
+		}
+
+		// a plane through the eye and each edge of what's left of the portal, facing in
+		glm::vec3 center(0.0f);
+		for (unsigned int p = 0; p < clipped.size(); ++p)
+			center += clipped[p];
+		center /= (float)clipped.size();
+
+		vector<glm::vec4> narrowed;
+		for (unsigned int p = 0; p < clipped.size(); ++p) {
+			glm::vec3 edgeNormal = glm::cross(clipped[p] - eye, clipped[(p + 1) % clipped.size()] - eye);
+			float length = glm::length(edgeNormal);
+			if (length < 1e-6f)
+				continue;
+			edgeNormal /= length;
+			if (glm::dot(edgeNormal, center - eye) < 0.0f)
+				edgeNormal = -edgeNormal;
+			narrowed.push_back(glm::vec4(edgeNormal, -glm::dot(edgeNormal, eye)));
+		}
+		walk(next, narrowed, depth + 1);
+	}
+	onPath[cell] = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef PORTALS_H
+#define PORTALS_H
+// portals.h
+// Defines the CellGraph class, which splits an indoor level into cells (rooms) joined by
+// portals (doorways), and works out which cells can be seen from the camera.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+
+const unsigned int MAX_PORTAL_DEPTH = 16; // most portals deep a walk goes
+const float PORTAL_NEAR = 0.2f; // how close the camera can get to a portal before it stops narrowing the view
+
+// A room of the level, as a box
+struct Cell {
+	glm::vec3 Min;
+	glm::vec3 Max;
+	std::vector<unsigned int> Portals;
+};
+
+// A convex polygon joining two cells, which can be seen through from either side
+struct Portal {
+	unsigned int CellA;
+	unsigned int CellB;
+	std::vector<glm::vec3> Points;
+};
+
+// CellGraph class
+// Cells and portals are loaded from a text file next to the level, one per line:
+//   cell minX minY minZ maxX maxY maxZ
+//   portal cellA cellB x y z x y z x y z ...
+// with cells numbered in the order they're given. Each frame, the walk starts in the
+// camera's cell with the view frustum. Every portal the frustum can see through has the
+// frustum clipped down to it, and the cell on the other side is walked with that. Anything
+// outside every cell (or a camera outside every cell) counts as visible.
+class CellGraph {
+	public:
+		CellGraph();
+
+		bool Load(const char*);
+		unsigned int AddCell(const glm::vec3&, const glm::vec3&);
+		unsigned int AddPortal(unsigned int, unsigned int, const std::vector<glm::vec3>&);
+
+		int FindCell(const glm::vec3&) const;
+		void FindVisible(const glm::vec3&, const glm::mat4&);
+		bool CellVisible(unsigned int) const;
+		bool PointVisible(const glm::vec3&) const;
+		bool BoxVisible(const glm::vec3&, const glm::vec3&) const;
+
+		bool Empty() const;
+		unsigned int NumCells() const;
+		unsigned int NumPortals() const;
+		unsigned int NumVisibleCells() const;
+		unsigned int NumPortalsTested() const;
+
+	private:
+		std::vector<Cell> cells;
+		std::vector<Portal> portals;
+
+		std::vector<unsigned char> visible; // per cell, from the last FindVisible
+		std::vector<unsigned char> onPath; // cells the walk is currently inside of, so it can't loop
+		glm::vec3 eye;
+		unsigned int portalsTested;
+
+		void walk(unsigned int, const std::vector<glm::vec4>&, unsigned int);
+};
+
+#endif
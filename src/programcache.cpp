@@ -0,0 +1,191 @@
+// programcache.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags, GLADloadproc
+
+// stdlib
+#include <string> // for string
+#include <vector> // for vector
+#include <fstream> // for ifstream, ofstream
+#include <iostream> // for cout, endl
+#include <cstdio> // for snprintf
+#include <cstdint> // for uint32_t, uint64_t
+#include <sys/stat.h> // for mkdir
+
+// our files
+#include "programcache.h" // for program cache declarations
+
+// the bits of GL 4.1 we need, since glad only has 3.3
+#define PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define PROGRAM_BINARY_LENGTH 0x8741
+#define NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void*, GLsizei);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+static GetProgramBinaryProc getProgramBinary = NULL;
+static ProgramBinaryProc programBinary = NULL;
+static ProgramParameteriProc programParameteri = NULL;
+
+static bool cacheEnabled = false;
+static std::string cacheDir;
+static std::string driver; // vendor, renderer and version, since binaries only work on the driver that made them
+
+// every cache file starts with this, then the version of the file layout
+static const char CACHE_MAGIC[4] = {'P', 'R', 'O', 'G'};
+static const uint32_t CACHE_VERSION = 1;
+
+// 64 bit FNV-1a, which is plenty for telling sources apart
+static uint64_t hashString(const std::string &str, uint64_t hash = 14695981039346656037ULL)
+{
+	for (unsigned int i = 0; i < str.size(); ++i)
+	{
+		hash ^= (unsigned char)str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Sets up the cache. Returns whether it's usable.
+bool initProgramCache(GLADloadproc load, const char *dir)
+{
+	cacheEnabled = false;
+
+	getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+	programBinary = (ProgramBinaryProc)load("glProgramBinary");
+	programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+	if (getProgramBinary == NULL || programBinary == NULL || programParameteri == NULL)
+		return false;
+
+	// some drivers have the functions but won't actually give out any binaries
+	int formats = 0;
+	glGetIntegerv(NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (glGetError() != GL_NO_ERROR || formats <= 0)
+		return false;
+
+	driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+	cacheDir = dir;
+	mkdir(cacheDir.c_str(), 0755);
+	cacheEnabled = true;
+	return true;
+}
+
+// Checks whether programs are being cached
+bool programCacheEnabled()
+{
+	return cacheEnabled;
+}
+
+// Makes the key a program is cached under, from its sources (with their defines already
+// in) and the key of its define set. The driver goes in too, so updating it misses the
+// cache instead of loading something stale.
+std::string programCacheKey(const std::string &vertexCode, const std::string &fragmentCode, const std::string &definesKey)
+{
+	uint64_t hash = hashString(vertexCode);
+	hash = hashString(fragmentCode, hash);
+	hash = hashString(definesKey, hash);
+	hash = hashString(driver, hash);
+
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+	return hex;
+}
+
+// Loads a cached program. Returns 0 if there isn't one, or if the driver won't take it,
+// in which case the caller should compile from source.
+unsigned int loadCachedProgram(const std::string &key)
+{
+	if (!cacheEnabled)
+		return 0;
+
+	std::ifstream file((cacheDir + "/" + key + ".bin").c_str(), std::ios::binary);
+	if (!file)
+		return 0;
+
+	char magic[4];
+	uint32_t version = 0, format = 0, driverLength = 0, length = 0;
+	file.read(magic, 4);
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&driverLength, sizeof(driverLength));
+	if (!file || std::string(magic, 4) != std::string(CACHE_MAGIC, 4) || version != CACHE_VERSION || driverLength > 4096)
+		return 0;
+
+	// the key is only a hash, so making sure it really was this driver
+	std::string fileDriver(driverLength, '\0');
+	file.read(&fileDriver[0], driverLength);
+	file.read((char*)&format, sizeof(format));
+	file.read((char*)&length, sizeof(length));
+	if (!file || fileDriver != driver || length == 0)
+		return 0;
+
+	// a truncated or corrupt file can claim any length, so it has to fit in what's left
+	std::streampos start = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff remaining = file.tellg() - start;
+	file.seekg(start);
+	if (!file || remaining < (std::streamoff)length)
+		return 0;
+
+	std::vector<char> binary(length);
+	file.read(&binary[0], length);
+	if (!file)
+		return 0;
+
+	unsigned int program = glCreateProgram();
+	programBinary(program, format, &binary[0], length);
+
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// Asks the driver to keep a program's binary around. Has to be done before linking.
+void prepareCachedProgram(unsigned int program)
+{
+	if (cacheEnabled)
+		programParameteri(program, PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// Saves a linked program to the cache. Returns whether it was saved.
+bool saveCachedProgram(const std::string &key, unsigned int program)
+{
+	if (!cacheEnabled)
+		return false;
+
+	int linked = 0, length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+		return false;
+
+	glGetProgramiv(program, PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	getProgramBinary(program, length, NULL, &format, &binary[0]);
+
+	std::string path = cacheDir + "/" + key + ".bin";
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Couldn't write program cache file " << path << std::endl;
+		return false;
+	}
+
+	uint32_t driverLength = driver.size(), binaryFormat = format, binaryLength = length;
+	file.write(CACHE_MAGIC, 4);
+	file.write((const char*)&CACHE_VERSION, sizeof(CACHE_VERSION));
+	file.write((const char*)&driverLength, sizeof(driverLength));
+	file.write(driver.data(), driverLength);
+	file.write((const char*)&binaryFormat, sizeof(binaryFormat));
+	file.write((const char*)&binaryLength, sizeof(binaryLength));
+	file.write(&binary[0], length);
+	return (bool)file;
+}
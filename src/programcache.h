@@ -0,0 +1,26 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+// programcache.h
+// Defines the program binary cache, which saves linked shader programs to disk so later
+// launches can load them instead of compiling from source.
+
+// libraries
+#include <glad/glad.h> // for opengl flags, GLADloadproc
+
+// stdlib
+#include <string> // for string
+
+const char* const PROGRAM_CACHE_DIR = "shadercache";
+
+// Loads the program binary functions (GL 4.1, or ARB_get_program_binary), which glad's 3.3
+// loader doesn't, and works out which driver we're on. The cache stays off if the driver
+// can't do program binaries.
+bool initProgramCache(GLADloadproc, const char* = PROGRAM_CACHE_DIR);
+bool programCacheEnabled();
+
+std::string programCacheKey(const std::string&, const std::string&, const std::string&);
+unsigned int loadCachedProgram(const std::string&);
+void prepareCachedProgram(unsigned int);
+bool saveCachedProgram(const std::string&, unsigned int);
+
+#endif
@@ -0,0 +1,129 @@
+// renderqueue.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <algorithm> // for stable_sort, min, max
+#include <cstdint> // for uint64_t
+using namespace std;
+
+// our files
+#include "renderqueue.h" // for RenderQueue declaration
+#include "shader.h" // for Shader class
+#include "mesh.h" // for Mesh class
+#include "glstate.h" // for GLStateCache class
+
+// how many bits each part of a sort key gets. The pass takes the top two.
+static const unsigned int SHADER_BITS = 12;
+static const unsigned int MATERIAL_BITS = 24;
+static const unsigned int DEPTH_BITS = 24;
+
+// Makes the key a draw is sorted by, from its pass, shader (program id), material and how
+// far it is from the camera (out of maxDepth). Smaller keys are drawn first.
+uint64_t renderSortKey(RenderPass pass, unsigned int shader, unsigned int material, float depth, float maxDepth) {
+	uint64_t shaderBits = shader & ((1u << SHADER_BITS) - 1);
+	uint64_t materialBits = material & ((1u << MATERIAL_BITS) - 1);
+	uint64_t depthBits = (uint64_t)(max(0.0f, min(depth / maxDepth, 1.0f)) * ((1u << DEPTH_BITS) - 1));
+
+	uint64_t key = (uint64_t)pass << 62;
+	if (pass == PASS_TRANSPARENT) {
+		// far to near first, and only then by state
+		depthBits = ((1u << DEPTH_BITS) - 1) - depthBits;
+		key |= depthBits << (62 - DEPTH_BITS);
+		key |= shaderBits << (62 - DEPTH_BITS - SHADER_BITS);
+		key |= materialBits << (62 - DEPTH_BITS - SHADER_BITS - MATERIAL_BITS);
+	}
+	else {
+		// by state first, then near to far within the same state
+		key |= shaderBits << (62 - SHADER_BITS);
+		key |= materialBits << (62 - SHADER_BITS - MATERIAL_BITS);
+		key |= depthBits << (62 - SHADER_BITS - MATERIAL_BITS - DEPTH_BITS);
+	}
+	return key;
+}
+
+// RenderQueue Constructor, given the farthest depth draws will be at
+RenderQueue::RenderQueue(float maxDepth) : maxDepth(maxDepth), lastSubmitted(0) {
+}
+
+// Adds a single draw of a mesh, with the given model matrix, at depth from the camera
+void RenderQueue::Add(Mesh &mesh, Shader &shader, const glm::mat4 &model, float depth, RenderPass pass) {
+	RenderItem item = {renderSortKey(pass, shader.ID, mesh.GetMaterialID(), depth, maxDepth), &mesh, &shader, model, 0};
+	items.push_back(item);
+}
+
+// Adds an instanced draw of a mesh, whose instance buffer is already filled in
+void RenderQueue::AddInstanced(Mesh &mesh, Shader &shader, unsigned int instances, float depth, RenderPass pass) {
+	if (instances == 0)
+		return;
+	RenderItem item = {renderSortKey(pass, shader.ID, mesh.GetMaterialID(), depth, maxDepth), &mesh, &shader, glm::mat4(1.0f), instances};
+	items.push_back(item);
+}
+
+// Sorts and draws everything in the queue, then empties it
+void RenderQueue::Submit() {
+	lastSubmitted = items.size();
+	if (items.empty())
+		return;
+
+	stable_sort(items.begin(), items.end(), [](const RenderItem &a, const RenderItem &b) { return a.Key < b.Key; });
+
+	// other code binds things straight through gl, so the cache can't trust anything from
+	// last frame. blending's put back how it was found afterwards.
+	state.Invalidate();
+	state.ResetCounts();
+	bool blendWas = glIsEnabled(GL_BLEND);
+
+	Shader *current = NULL;
+	UniformHandle modelUniform = -1;
+	for (unsigned int i = 0; i < items.size(); ++i) {
+		RenderItem &item = items[i];
+
+		bool transparent = (item.Key >> 62) == PASS_TRANSPARENT;
+		state.SetBlend(transparent);
+		if (transparent)
+			state.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		state.UseProgram(item.DrawShader->ID);
+		if (item.DrawShader != current) {
+			current = item.DrawShader;
+			modelUniform = current->Uniform("model");
+		}
+		item.DrawMesh->SetUnpacking(*current);
+		if (item.Instances == 0)
+			current->setMat4(modelUniform, item.Model);
+
+		item.DrawMesh->BindTextures(*current, state);
+		state.BindVertexArray(item.DrawMesh->GetVAO());
+		item.DrawMesh->DrawElements(item.Instances);
+	}
+
+	// leaving things the way the rest of the code expects them
+	state.BindVertexArray(0);
+	state.ActiveTexture(0);
+	state.SetBlend(blendWas);
+	items.clear();
+}
+
+// Gets how many draws are waiting in the queue
+unsigned int RenderQueue::Size() const {
+	return items.size();
+}
+
+// Gets how many draws the last Submit made
+unsigned int RenderQueue::NumSubmitted() const {
+	return lastSubmitted;
+}
+
+// Gets how many state changes the last Submit made
+unsigned int RenderQueue::NumStateChanges() const {
+	return state.NumChanges();
+}
+
+// Gets how many redundant state changes the last Submit skipped
+unsigned int RenderQueue::NumStateChangesFiltered() const {
+	return state.NumFiltered();
+}
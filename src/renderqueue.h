@@ -0,0 +1,64 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+// renderqueue.h
+// Defines the RenderQueue class, which collects a frame's draws and submits them sorted so
+// that as little gl state as possible changes between them.
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <cstdint> // for uint64_t
+
+// our files
+#include "shader.h" // for Shader class
+#include "mesh.h" // for Mesh class
+#include "glstate.h" // for GLStateCache class
+#include "camera.h" // for FAR_PLANE
+
+// Passes are drawn in order. Opaque draws are sorted front to back, so the depth test
+// throws away more of what's behind them, and transparent ones back to front, so they
+// blend right.
+enum RenderPass {
+	PASS_OPAQUE,
+	PASS_TRANSPARENT
+};
+
+uint64_t renderSortKey(RenderPass, unsigned int, unsigned int, float, float = FAR_PLANE);
+
+// A draw waiting in the queue
+struct RenderItem {
+	uint64_t Key;
+	Mesh *DrawMesh;
+	Shader *DrawShader;
+	glm::mat4 Model;
+	unsigned int Instances; // 0 for a single draw with Model, otherwise how many instances
+};
+
+// RenderQueue class
+// Sort keys are 64 bits: the pass at the top, then the shader and material (opaque) or the
+// depth (transparent), then whatever's left. Everything's submitted through a state cache,
+// so switching to a shader, vertex array or texture that's already bound costs nothing.
+class RenderQueue {
+	public:
+		RenderQueue(float = FAR_PLANE);
+
+		void Add(Mesh&, Shader&, const glm::mat4&, float, RenderPass = PASS_OPAQUE);
+		void AddInstanced(Mesh&, Shader&, unsigned int, float, RenderPass = PASS_OPAQUE);
+		void Submit();
+
+		unsigned int Size() const;
+		unsigned int NumSubmitted() const;
+		unsigned int NumStateChanges() const;
+		unsigned int NumStateChangesFiltered() const;
+
+	private:
+		float maxDepth;
+		std::vector<RenderItem> items;
+		GLStateCache state;
+		unsigned int lastSubmitted;
+};
+
+#endif
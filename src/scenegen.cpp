@@ -0,0 +1,307 @@
+// scenegen.cpp
+// Generates seeded synthetic levels. The same type, triangle count and seed always give the
+// same level and spawns, so runs can be compared against each other.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <iostream> // for cout
+#include <fstream> // for ofstream, ifstream
+#include <vector> // for vector
+#include <string> // for string
+#include <random> // for mt19937
+#include <cmath> // for sqrt, cbrt, sin
+#include <algorithm> // for min, max
+using namespace std;
+
+// our files
+#include "scenegen.h" // for generateScene declarations
+#include "shapes.h" // for Triangle and Ellipsoid classes
+
+// Adds the two triangles of a quad, with corner p and edges u and v. The quad faces along
+// cross(u, v).
+static void addQuad(vector<Triangle> &tris, const glm::vec3 &p, const glm::vec3 &u, const glm::vec3 &v) {
+	tris.push_back(Triangle(p, p + u, p + v));
+	tris.push_back(Triangle(p + u + v, p + v, p + u));
+}
+
+// Adds an axis-aligned box, facing outwards
+static void addBox(vector<Triangle> &tris, const glm::vec3 &min, const glm::vec3 &size) {
+	glm::vec3 x(size.x, 0.0f, 0.0f), y(0.0f, size.y, 0.0f), z(0.0f, 0.0f, size.z);
+	addQuad(tris, min + y, z, x); // top
+	addQuad(tris, min, x, z); // bottom
+	addQuad(tris, min + x, y, z); // +x
+	addQuad(tris, min, z, y); // -x
+	addQuad(tris, min + z, x, y); // +z
+	addQuad(tris, min, y, x); // -z
+}
+
+// Random number helpers
+static float randRange(mt19937 &rng, float min, float max) {
+	return uniform_real_distribution<float>(min, max)(rng);
+}
+static unsigned int randIndex(mt19937 &rng, unsigned int count) {
+	return uniform_int_distribution<unsigned int>(0, count - 1)(rng);
+}
+
+// Makes a body with a random size and a small sideways velocity. Most are spheres, but
+// every fourth is stretched upwards so the ellipsoid path gets some work too.
+static Ellipsoid randomBody(mt19937 &rng, const glm::vec3 &ground) {
+	float radius = randRange(rng, 0.25f, 0.75f);
+	glm::vec3 radii(radius);
+	if (randIndex(rng, 4) == 0)
+		radii.y *= 2.0f;
+
+	glm::vec3 velocity(randRange(rng, -0.05f, 0.05f), 0.0f, randRange(rng, -0.05f, 0.05f));
+	return Ellipsoid(radii, ground + glm::vec3(0.0f, radii.y + randRange(rng, 0.1f, 2.0f), 0.0f), velocity);
+}
+
+// Flights of stairs side by side, climbing along +z
+static void generateStairs(GeneratedScene &scene, unsigned int numTris, mt19937 &rng, unsigned int numBodies) {
+	const float WIDTH = 4.0f, RUN = 0.5f, RISE = 0.25f, GAP = 1.0f;
+	unsigned int flights = max(1u, numTris / (4 * STAIR_STEPS));
+	unsigned int perRow = (unsigned int)ceil(sqrt((float)flights));
+	float flightDepth = STAIR_STEPS * RUN;
+
+	scene.Tris.reserve(flights * 4 * STAIR_STEPS);
+	for (unsigned int f = 0; f < flights; ++f) {
+		glm::vec3 origin((f % perRow) * (WIDTH + GAP), 0.0f, (f / perRow) * (flightDepth + GAP));
+		for (unsigned int i = 0; i < STAIR_STEPS; ++i) {
+			glm::vec3 tread = origin + glm::vec3(0.0f, (i + 1) * RISE, i * RUN);
+			glm::vec3 riser = origin + glm::vec3(0.0f, i * RISE, i * RUN);
+			addQuad(scene.Tris, tread, glm::vec3(0.0f, 0.0f, RUN), glm::vec3(WIDTH, 0.0f, 0.0f));
+			addQuad(scene.Tris, riser, glm::vec3(0.0f, RISE, 0.0f), glm::vec3(WIDTH, 0.0f, 0.0f));
+		}
+	}
+
+	for (unsigned int b = 0; b < numBodies; ++b) {
+		unsigned int f = randIndex(rng, flights);
+		unsigned int i = randIndex(rng, STAIR_STEPS);
+		glm::vec3 origin((f % perRow) * (WIDTH + GAP), 0.0f, (f / perRow) * (flightDepth + GAP));
+		glm::vec3 ground = origin + glm::vec3(randRange(rng, 0.5f, WIDTH - 0.5f), (i + 1) * RISE, (i + 0.5f) * RUN);
+		scene.Spawns.push_back(randomBody(rng, ground));
+	}
+}
+
+// A square grid of rolling hills
+static void generateHeightfield(GeneratedScene &scene, unsigned int numTris, mt19937 &rng, unsigned int numBodies) {
+	const unsigned int OCTAVES = 4;
+	unsigned int cells = max(1u, (unsigned int)sqrt(numTris / 2.0f));
+
+	float amplitude[OCTAVES], frequency[OCTAVES], phaseX[OCTAVES], phaseZ[OCTAVES];
+	for (unsigned int o = 0; o < OCTAVES; ++o) {
+		amplitude[o] = 4.0f / (1 << o);
+		frequency[o] = 0.05f * (1 << o);
+		phaseX[o] = randRange(rng, 0.0f, 6.2832f);
+		phaseZ[o] = randRange(rng, 0.0f, 6.2832f);
+	}
+	auto height = [&](float x, float z) {
+		float h = 0.0f;
+		for (unsigned int o = 0; o < OCTAVES; ++o)
+			h += amplitude[o] * sin(frequency[o] * x + phaseX[o]) * cos(frequency[o] * z + phaseZ[o]);
+		return h;
+	};
+
+	// computing each corner once, instead of once per triangle touching it
+	vector<float> heights((cells + 1) * (cells + 1));
+	for (unsigned int z = 0; z <= cells; ++z)
+		for (unsigned int x = 0; x <= cells; ++x)
+			heights[z * (cells + 1) + x] = height(x, z);
+
+	scene.Tris.reserve(cells * cells * 2);
+	for (unsigned int z = 0; z < cells; ++z) {
+		for (unsigned int x = 0; x < cells; ++x) {
+			glm::vec3 p00(x, heights[z * (cells + 1) + x], z);
+			glm::vec3 p10(x + 1, heights[z * (cells + 1) + x + 1], z);
+			glm::vec3 p01(x, heights[(z + 1) * (cells + 1) + x], z + 1);
+			glm::vec3 p11(x + 1, heights[(z + 1) * (cells + 1) + x + 1], z + 1);
+			scene.Tris.push_back(Triangle(p00, p01, p10));
+			scene.Tris.push_back(Triangle(p11, p10, p01));
+		}
+	}
+
+	for (unsigned int b = 0; b < numBodies; ++b) {
+		float x = randRange(rng, 0.0f, cells), z = randRange(rng, 0.0f, cells);
+		// the surface can be above the analytic height between corners, so aiming a bit high
+		scene.Spawns.push_back(randomBody(rng, glm::vec3(x, height(x, z) + 1.0f, z)));
+	}
+}
+
+// Random triangles scattered through a cube, at the same density no matter the count
+static void generateSoup(GeneratedScene &scene, unsigned int numTris, mt19937 &rng, unsigned int numBodies) {
+	const float SPACING = 2.0f; // average distance between triangles
+	float side = cbrt((float)max(1u, numTris)) * SPACING;
+
+	scene.Tris.reserve(numTris);
+	while (scene.Tris.size() < numTris) {
+		glm::vec3 centre(randRange(rng, 0.0f, side), randRange(rng, 0.0f, side), randRange(rng, 0.0f, side));
+		glm::vec3 verts[3];
+		for (unsigned int i = 0; i < 3; ++i)
+			verts[i] = centre + glm::vec3(randRange(rng, -1.0f, 1.0f), randRange(rng, -1.0f, 1.0f), randRange(rng, -1.0f, 1.0f));
+
+		// skipping slivers, which don't have a usable normal
+		if (glm::length(glm::cross(verts[1] - verts[0], verts[2] - verts[0])) < 0.01f)
+			continue;
+		scene.Tris.push_back(Triangle(verts[0], verts[1], verts[2]));
+	}
+
+	for (unsigned int b = 0; b < numBodies; ++b) {
+		glm::vec3 ground(randRange(rng, 0.0f, side), randRange(rng, 0.0f, side), randRange(rng, 0.0f, side));
+		scene.Spawns.push_back(randomBody(rng, ground));
+	}
+}
+
+// Stacks of unit crates on a floor. Every crate is a copy of the same box, moved into place.
+static void generateCrates(GeneratedScene &scene, unsigned int numTris, mt19937 &rng, unsigned int numBodies) {
+	const float SPACING = 1.5f;
+	vector<Triangle> crate;
+	addBox(crate, glm::vec3(0.0f), glm::vec3(1.0f));
+
+	unsigned int crates = max(1u, (numTris - min(numTris, 2u)) / (unsigned int)crate.size());
+	// picking a grid big enough for average-height stacks
+	unsigned int perRow = (unsigned int)ceil(sqrt(crates / ((CRATE_MAX_STACK + 1) / 2.0f)));
+
+	scene.Tris.reserve(2 + crates * crate.size());
+
+	vector<unsigned int> stackHeights;
+	for (unsigned int placed = 0, stack = 0; placed < crates; ++stack) {
+		unsigned int height = min(crates - placed, 1 + randIndex(rng, CRATE_MAX_STACK));
+		glm::vec3 base((stack % perRow) * SPACING, 0.0f, (stack / perRow) * SPACING);
+		for (unsigned int h = 0; h < height; ++h) {
+			glm::vec3 offset = base + glm::vec3(0.0f, h, 0.0f);
+			for (unsigned int i = 0; i < crate.size(); ++i) {
+				const Triangle &tri = crate[i];
+				scene.Tris.push_back(Triangle(tri.Vertices[0] + offset, tri.Vertices[1] + offset, tri.Vertices[2] + offset, tri.Normal));
+			}
+		}
+		stackHeights.push_back(height);
+		placed += height;
+	}
+
+	// the floor goes under every stack, with a crate's gap around the edges
+	unsigned int rows = (stackHeights.size() + perRow - 1) / perRow;
+	addQuad(scene.Tris, glm::vec3(-SPACING, 0.0f, -SPACING), glm::vec3(0.0f, 0.0f, (rows + 1) * SPACING + 1.0f), glm::vec3((perRow + 1) * SPACING + 1.0f, 0.0f, 0.0f));
+
+	for (unsigned int b = 0; b < numBodies; ++b) {
+		unsigned int stack = randIndex(rng, stackHeights.size());
+		glm::vec3 ground((stack % perRow) * SPACING + 0.5f, stackHeights[stack], (stack / perRow) * SPACING + 0.5f);
+		scene.Spawns.push_back(randomBody(rng, ground));
+	}
+}
+
+// Generates a level of about numTris triangles (as close as the level's pieces allow), plus
+// numBodies bodies to drop into it
+GeneratedScene generateScene(SceneType type, unsigned int numTris, unsigned int seed, unsigned int numBodies) {
+	GeneratedScene scene;
+	mt19937 rng(seed);
+
+	switch (type) {
+		case SCENE_STAIRS:
+			generateStairs(scene, numTris, rng, numBodies);
+			break;
+		case SCENE_HEIGHTFIELD:
+			generateHeightfield(scene, numTris, rng, numBodies);
+			break;
+		case SCENE_SOUP:
+			generateSoup(scene, numTris, rng, numBodies);
+			break;
+		case SCENE_CRATES:
+			generateCrates(scene, numTris, rng, numBodies);
+			break;
+	}
+
+	scene.Min = glm::vec3(0.0f);
+	scene.Max = glm::vec3(0.0f);
+	for (unsigned int i = 0; i < scene.Tris.size(); ++i) {
+		for (unsigned int j = 0; j < 3; ++j) {
+			const glm::vec3 &v = scene.Tris[i].Vertices[j];
+			scene.Min = (i == 0 && j == 0) ? v : glm::min(scene.Min, v);
+			scene.Max = (i == 0 && j == 0) ? v : glm::max(scene.Max, v);
+		}
+	}
+
+	return scene;
+}
+
+static const char *SCENE_NAMES[] = {"stairs", "heightfield", "soup", "crates"};
+
+// Finds the scene type with the given name. Returns whether there was one.
+bool parseSceneType(const string &name, SceneType &type) {
+	for (unsigned int i = 0; i < 4; ++i) {
+		if (name == SCENE_NAMES[i]) {
+			type = (SceneType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Gets the name of a scene type
+const char* sceneTypeName(SceneType type) {
+	return SCENE_NAMES[type];
+}
+
+// Writes the level's triangles to an OBJ file, which Model can load to render it.
+// Returns whether it could be written.
+bool writeSceneOBJ(const GeneratedScene &scene, const char *path) {
+	ofstream file(path);
+	if (!file) {
+		cout << "Failed to open " << path << " for writing" << endl;
+		return false;
+	}
+
+	file << "# generated level, " << scene.Tris.size() << " triangles\n";
+	for (unsigned int i = 0; i < scene.Tris.size(); ++i) {
+		const Triangle &tri = scene.Tris[i];
+		for (unsigned int j = 0; j < 3; ++j)
+			file << "v " << tri.Vertices[j].x << " " << tri.Vertices[j].y << " " << tri.Vertices[j].z << "\n";
+		file << "vn " << tri.Normal.x << " " << tri.Normal.y << " " << tri.Normal.z << "\n";
+	}
+	for (unsigned int i = 0; i < scene.Tris.size(); ++i) {
+		unsigned int v = i * 3 + 1, n = i + 1;
+		file << "f " << v << "//" << n << " " << v + 1 << "//" << n << " " << v + 2 << "//" << n << "\n";
+	}
+
+	return (bool)file;
+}
+
+// Writes the spawns out, one body per line as "position radii velocity".
+// Returns whether it could be written.
+bool writeSceneSpawns(const GeneratedScene &scene, const char *path) {
+	ofstream file(path);
+	if (!file) {
+		cout << "Failed to open " << path << " for writing" << endl;
+		return false;
+	}
+
+	for (unsigned int i = 0; i < scene.Spawns.size(); ++i) {
+		const Ellipsoid &body = scene.Spawns[i];
+		file << body.Position.x << " " << body.Position.y << " " << body.Position.z << " "
+		     << body.Radii.x << " " << body.Radii.y << " " << body.Radii.z << " "
+		     << body.Velocity.x << " " << body.Velocity.y << " " << body.Velocity.z << "\n";
+	}
+
+	return (bool)file;
+}
+
+// Reads spawns written by writeSceneSpawns back in, adding them to spawns. Returns whether
+// the file could be opened and every line was a body.
+bool readSceneSpawns(const char *path, vector<Ellipsoid> &spawns) {
+	ifstream file(path);
+	if (!file)
+		return false;
+
+	glm::vec3 position, radii, velocity;
+	while (file >> position.x >> position.y >> position.z
+	            >> radii.x >> radii.y >> radii.z
+	            >> velocity.x >> velocity.y >> velocity.z) {
+		spawns.push_back(Ellipsoid(radii, position, velocity));
+	}
+
+	if (!file.eof()) {
+		cout << "Failed to read the spawns in " << path << endl;
+		return false;
+	}
+	return true;
+}
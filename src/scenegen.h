@@ -0,0 +1,38 @@
+#ifndef SCENEGEN_H
+#define SCENEGEN_H
+// scenegen.h
+// Functions for generating seeded synthetic levels, used to stress the physics and renderer.
+
+// libraries
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <vector> // for vector
+#include <string> // for string
+
+// our files
+#include "shapes.h" // for Triangle and Ellipsoid classes
+
+const unsigned int SCENE_BODIES = 256; // bodies spawned by default
+const unsigned int STAIR_STEPS = 32; // steps in each flight of stairs
+const unsigned int CRATE_MAX_STACK = 6; // tallest a stack of crates gets
+
+enum SceneType { SCENE_STAIRS, SCENE_HEIGHTFIELD, SCENE_SOUP, SCENE_CRATES };
+
+// A generated level, along with some bodies to drop into it
+struct GeneratedScene {
+	std::vector<Triangle> Tris;
+	std::vector<Ellipsoid> Spawns;
+	glm::vec3 Min, Max; // bounds of the triangles
+};
+
+GeneratedScene generateScene(SceneType, unsigned int, unsigned int, unsigned int = SCENE_BODIES);
+
+bool parseSceneType(const std::string&, SceneType&);
+const char* sceneTypeName(SceneType);
+
+bool writeSceneOBJ(const GeneratedScene&, const char*);
+bool writeSceneSpawns(const GeneratedScene&, const char*);
+bool readSceneSpawns(const char*, std::vector<Ellipsoid>&);
+
+#endif
@@ -9,12 +9,53 @@
 #include <fstream> // for ifstream
 #include <sstream> // for stringstream
 #include <iostream> // for cin, cout, endl
+#include <unordered_map> // for unordered_map
+#include <map> // for map
+#include <utility> // for piecewise_construct
+#include <tuple> // for forward_as_tuple
 
 // our files
 #include "shader.h" // for Shader declaration
+#include "uniformbuffers.h" // for bindUniformBlocks
+#include "programcache.h" // for loadCachedProgram, saveCachedProgram
+#include "glhandles.h" // for ProgramHandle
 
-// Shader Constructor
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+// Adds the defines to a shader's source, straight after its #version line (which has to
+// come first)
+static std::string addDefines(const std::string &code, const ShaderDefines &defines)
+{
+	if (defines.empty())
+		return code;
+
+	std::string lines;
+	for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+	{
+		lines += "#define " + it->first + " " + it->second + "\n";
+	}
+
+	std::string::size_type start = 0;
+	if (code.compare(0, 8, "#version") == 0)
+	{
+		start = code.find('\n');
+		start = (start == std::string::npos) ? code.size() : start + 1;
+	}
+	return code.substr(0, start) + lines + code.substr(start);
+}
+
+// Turns a set of defines into a string that's the same for the same set, like
+// "DO_EMISSION=0;NUM_DIR_LIGHTS=1;"
+std::string shaderDefinesKey(const ShaderDefines &defines)
+{
+	std::string key;
+	for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+	{
+		key += it->first + "=" + it->second + ";";
+	}
+	return key;
+}
+
+// Shader Constructor. The defines are added to both stages' sources.
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines &defines)
 {
 	// 1. first get the source from filepath
 	std::string vertexCode;
@@ -45,10 +86,29 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	{
 	  std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
 	}
+	vertexCode = addDefines(vertexCode, defines);
+	fragmentCode = addDefines(fragmentCode, defines);
+
+	// 2. load the program from the cache if these exact sources were linked before,
+	// otherwise compile it and cache it for next time
+	std::string cacheKey = programCacheKey(vertexCode, fragmentCode, shaderDefinesKey(defines));
+	ID = ProgramHandle(loadCachedProgram(cacheKey));
+	if (ID == 0)
+	{
+		ID = ProgramHandle(compileProgram(vertexCode, fragmentCode));
+		saveCachedProgram(cacheKey, ID);
+	}
+
+	reflectUniforms();
+	bindUniformBlocks(ID);
+}
+
+// Compiles and links a program from source, returning its ID
+unsigned int Shader::compileProgram(const std::string &vertexCode, const std::string &fragmentCode)
+{
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
-	
-	// 2. compile shaders
+
 	unsigned int vertex, fragment;
 	int success;
 	char infoLog[512];
@@ -78,21 +138,62 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	}
 	
 	// shader program
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	prepareCachedProgram(program);
+	glLinkProgram(program);
 	// get and output errors if any
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-	  glGetProgramInfoLog(ID, 512, NULL, infoLog);
+	  glGetProgramInfoLog(program, 512, NULL, infoLog);
 	  std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 	}
 	
 	// delete used shaders
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
+
+	return program;
+}
+
+// Reads every active uniform's name and location out of the linked program, so that
+// looking them up later doesn't need to ask the driver
+void Shader::reflectUniforms()
+{
+	uniforms.clear();
+
+	int count = 0, maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::string name(maxLength, '\0');
+	for (int i = 0; i < count; ++i)
+	{
+		int length = 0, size = 0;
+		GLenum type;
+		glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+		std::string uniformName = name.substr(0, length);
+
+		// arrays of plain types are reported once, as "name[0]", so we add every element
+		// (and the bare name, which GL also accepts)
+		std::string::size_type bracket = uniformName.rfind("[0]");
+		if (size > 1 && bracket != std::string::npos && bracket + 3 == uniformName.size())
+		{
+			std::string base = uniformName.substr(0, bracket);
+			uniforms[base] = glGetUniformLocation(ID, uniformName.c_str());
+			for (int j = 0; j < size; ++j)
+			{
+				std::string element = base + "[" + std::to_string(j) + "]";
+				uniforms[element] = glGetUniformLocation(ID, element.c_str());
+			}
+		}
+		else
+		{
+			uniforms[uniformName] = glGetUniformLocation(ID, uniformName.c_str());
+		}
+	}
 }
 
 void Shader::use()
@@ -100,23 +201,77 @@ void Shader::use()
 	glUseProgram(ID);
 }
 
+// Finds a uniform's handle, or -1 if the shader doesn't have it (or the compiler optimized
+// it out). Meant to be called once, with the handle kept around for setting it.
+UniformHandle Shader::Uniform(const std::string &name) const
+{
+	std::unordered_map<std::string, UniformHandle>::const_iterator it = uniforms.find(name);
+	if (it == uniforms.end())
+		return -1;
+	return it->second;
+}
+
 void Shader::setBool(const std::string &name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	setBool(Uniform(name), value);
 }
 void Shader::setInt(const std::string &name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	setInt(Uniform(name), value);
 }
 void Shader::setFloat(const std::string &name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	setFloat(Uniform(name), value);
 }
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	setVec3(Uniform(name), value);
 }
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	setMat4(Uniform(name), mat);
+}
+
+void Shader::setBool(UniformHandle handle, bool value) const
+{
+	glUniform1i(handle, (int)value);
+}
+void Shader::setInt(UniformHandle handle, int value) const
+{
+	glUniform1i(handle, value);
+}
+void Shader::setFloat(UniformHandle handle, float value) const
+{
+	glUniform1f(handle, value);
+}
+void Shader::setVec3(UniformHandle handle, const glm::vec3 &value) const
+{
+	glUniform3fv(handle, 1, &value[0]);
+}
+void Shader::setMat4(UniformHandle handle, const glm::mat4 &mat) const
+{
+	glUniformMatrix4fv(handle, 1, GL_FALSE, &mat[0][0]);
+}
+
+// ShaderVariants Constructor. Nothing is compiled until a variant is asked for.
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath) : vertexPath(vertexPath), fragmentPath(fragmentPath)
+{
+}
+
+// Gets the variant compiled with the given defines, compiling it if it's new
+Shader& ShaderVariants::Get(const ShaderDefines &defines)
+{
+	std::string key = shaderDefinesKey(defines);
+	std::map<std::string, Shader>::iterator it = variants.find(key);
+	if (it != variants.end())
+		return it->second;
+
+	it = variants.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(vertexPath.c_str(), fragmentPath.c_str(), defines)).first;
+	return it->second;
+}
+
+// Gets how many variants have been compiled so far
+unsigned int ShaderVariants::NumVariants() const
+{
+	return variants.size();
 }
@@ -12,21 +12,72 @@
 #include <fstream> // for ifstream
 #include <sstream> // for stringstream
 #include <iostream> // for cin, cout, endl
+#include <unordered_map> // for unordered_map
+#include <map> // for map
 
+// our files
+#include "glhandles.h" // for ProgramHandle
+
+// A uniform's location, looked up once with Shader::Uniform so it can be set without any
+// string work. -1 for a uniform the shader doesn't have, which GL quietly ignores.
+typedef int UniformHandle;
+
+// A set of #defines to compile a shader with, as name -> value. Kept sorted, so the same
+// set always makes the same key.
+typedef std::map<std::string, std::string> ShaderDefines;
+
+std::string shaderDefinesKey(const ShaderDefines&);
+
+// Shader class
+// Owns its program, so shaders can be moved but not copied. Pass them around by reference.
 class Shader
 {
 public:
-  unsigned int ID;
+  ProgramHandle ID;
 
-  Shader(const char*, const char*);
+  Shader(const char*, const char*, const ShaderDefines& = ShaderDefines());
 
   void use();
 
+  UniformHandle Uniform(const std::string&) const;
+
   void setBool(const std::string&, bool) const;
   void setInt(const std::string&, int) const;
   void setFloat(const std::string&, float) const;
   void setVec3(const std::string&, const glm::vec3&) const;
   void setMat4(const std::string&, const glm::mat4&) const;
+
+  void setBool(UniformHandle, bool) const;
+  void setInt(UniformHandle, int) const;
+  void setFloat(UniformHandle, float) const;
+  void setVec3(UniformHandle, const glm::vec3&) const;
+  void setMat4(UniformHandle, const glm::mat4&) const;
+
+private:
+  // every active uniform's location, read back from the program once it's linked
+  std::unordered_map<std::string, UniformHandle> uniforms;
+
+  void reflectUniforms();
+  unsigned int compileProgram(const std::string&, const std::string&);
+};
+
+// ShaderVariants class
+// Compiles a specialized copy of one shader for each set of defines it's asked for, the
+// first time it's asked, and keeps it around for next time.
+class ShaderVariants
+{
+public:
+  ShaderVariants(const char*, const char*);
+
+  Shader& Get(const ShaderDefines&);
+  unsigned int NumVariants() const;
+
+private:
+  std::string vertexPath;
+  std::string fragmentPath;
+
+  // keyed by shaderDefinesKey. Shaders in a map stay put, so Get can hand out references.
+  std::map<std::string, Shader> variants;
 };
 
 #endif
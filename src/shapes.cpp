@@ -48,11 +48,82 @@ void Triangle::Print() const
 
 // Ellipsoid Class
 ///////////////////////////////////////////////////////////////////////////////////////////
-Ellipsoid::Ellipsoid(glm::vec3 radii, glm::vec3 position, glm::vec3 velocity)
+// Picks the cheapest collider shape that can represent the given radii
+ColliderShape classifyRadii(const glm::vec3 &radii)
+{
+	const float EPSILON = 0.00001f;
+
+	if (std::abs(radii.x - radii.y) > EPSILON || std::abs(radii.x - radii.z) > EPSILON)
+		return ELLIPSOID;
+	if (std::abs(radii.x - 1.0f) > EPSILON)
+		return UNIFORM_SPHERE;
+	return UNIT_SPHERE;
+}
+
+// Picks the collider shape for an ellipsoid with the given radii and orientation. Spheres
+// look the same however they're turned, so they ignore the orientation.
+ColliderShape classifyShape(const glm::vec3 &radii, const glm::quat &orientation)
+{
+	const float EPSILON = 0.00001f;
+
+	ColliderShape shape = classifyRadii(radii);
+	if (shape == ELLIPSOID && std::abs(orientation.w) < 1.0f - EPSILON)
+		return ORIENTED_ELLIPSOID;
+	return shape;
+}
+
+Ellipsoid::Ellipsoid(glm::vec3 radii, glm::vec3 position, glm::vec3 velocity, glm::quat orientation)
 {
 	Radii = radii;
+	Orientation = orientation;
 	Position = position;
 	Velocity = velocity;
+	UpdateColliderSpace();
+}
+
+// Sets the radii, and re-picks the collider shape to match them
+void Ellipsoid::SetRadii(glm::vec3 radii)
+{
+	Radii = radii;
+	UpdateColliderSpace();
+}
+
+// Sets the orientation, and re-picks the collider shape to match it
+void Ellipsoid::SetOrientation(glm::quat orientation)
+{
+	Orientation = glm::normalize(orientation);
+	UpdateColliderSpace();
+}
+
+// Re-picks the collider shape, and recomputes what's cached for it. Needs calling after
+// changing Radii or Orientation directly.
+void Ellipsoid::UpdateColliderSpace()
+{
+	Shape = classifyShape(Radii, Orientation);
+	InvRadius = 1.0f / Radii.x;
+
+	// undoing the rotation, then squishing each axis down to a unit
+	glm::mat3 unrotate = glm::transpose(glm::mat3_cast(Orientation));
+	for (unsigned int i = 0; i < 3; ++i)
+		for (unsigned int j = 0; j < 3; ++j)
+			unrotate[i][j] /= Radii[j];
+	ToCollider = unrotate;
+}
+
+// Gets half the size of the box around the Ellipsoid along each world axis
+glm::vec3 Ellipsoid::Extents() const
+{
+	if (Shape != ORIENTED_ELLIPSOID)
+		return Radii;
+
+	glm::mat3 rotation = glm::mat3_cast(Orientation);
+	glm::vec3 extents;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		glm::vec3 row(rotation[0][i] * Radii.x, rotation[1][i] * Radii.y, rotation[2][i] * Radii.z);
+		extents[i] = glm::length(row);
+	}
+	return extents;
 }
 
 // Prints the Ellipsoid to std::cout
@@ -60,16 +131,21 @@ void Ellipsoid::Print() const
 {
 	std::cout << "Radii: " << Radii[0] << ", " << Radii[1] << ", " << Radii[2] << " | ";
 	std::cout << "Position: (" << Position[0] << ", " << Position[1] << ", " << Position[2] << ") | ";
-	std::cout << "Velocity: (" << Velocity[0] << ", " << Velocity[1] << ", " << Velocity[2] << ")";
+	std::cout << "Velocity: (" << Velocity[0] << ", " << Velocity[1] << ", " << Velocity[2] << ") | ";
+	std::cout << "Orientation: (" << Orientation.w << ", " << Orientation.x << ", " << Orientation.y << ", " << Orientation.z << ")";
 }
 
-// Converts a 3D point into Ellipsoid space - a space squished the proper amount in each dimension to make the ellipsoid into a unit sphere
+// Converts a 3D point into Ellipsoid space - a space rotated and squished the proper amount in each dimension to make the ellipsoid into a unit sphere
 glm::vec3 Ellipsoid::toEllipSpace(const glm::vec3 &point) const {
+	if (Shape == ORIENTED_ELLIPSOID)
+		return ToCollider * point;
 	return point / Radii;
 }
 
 // Converts a 3D point back from Ellipsoid space
 glm::vec3 Ellipsoid::fromEllipSpace(const glm::vec3 &point) const {
+	if (Shape == ORIENTED_ELLIPSOID)
+		return Orientation * (point * Radii);
 	return point * Radii;
 }
 
@@ -8,6 +8,7 @@
 #include <glm/glm.hpp> // for gl maths
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp> // for quat
 
 // stdlib
 #include <iostream> // for cout
@@ -28,6 +29,18 @@ class Triangle
 		void Print() const;
 };
 
+// Shape of an Ellipsoid's collider. Picked once from its radii, and used to pick which
+// specialization of the collision sweep it goes through.
+enum ColliderShape {
+	UNIT_SPHERE, // radii of (1, 1, 1): collider space is world space
+	UNIFORM_SPHERE, // equal radii: collider space is a uniform scale
+	ELLIPSOID, // anything else: collider space is a per-axis scale
+	ORIENTED_ELLIPSOID // a rotated ellipsoid: collider space is a rotation, then a per-axis scale
+};
+
+ColliderShape classifyRadii(const glm::vec3&);
+ColliderShape classifyShape(const glm::vec3&, const glm::quat&);
+
 // Ellipsoid class. Used for objects which collide with level geometry
 class Ellipsoid
 {
@@ -35,9 +48,18 @@ class Ellipsoid
 		glm::vec3 Radii;
 		glm::vec3 Position;
 		glm::vec3 Velocity;
+		glm::quat Orientation;
+
+		ColliderShape Shape;
+		float InvRadius; // 1 / Radii.x, only meaningful for spheres
+		glm::mat3 ToCollider; // world to collider space, only meaningful for oriented ellipsoids
 
-		Ellipsoid(glm::vec3, glm::vec3, glm::vec3);
+		Ellipsoid(glm::vec3, glm::vec3, glm::vec3, glm::quat = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
 
+		void SetRadii(glm::vec3);
+		void SetOrientation(glm::quat);
+		void UpdateColliderSpace();
+		glm::vec3 Extents() const;
 		void Print() const;
 
 		glm::vec3 toEllipSpace(const glm::vec3&) const;
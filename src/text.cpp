@@ -15,6 +15,7 @@
 #include "utils.h" // for utility functions
 #include "shader.h" // for Shader class
 #include "text.h" // for Text declaration
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle, TextureHandle
 
 // Text Constructor
 Text::Text(std::string str, unsigned int scrWidth, unsigned int scrHeight, unsigned int xMin, unsigned int yMin, unsigned int maxWidth, unsigned int charSize, unsigned int padding)
@@ -30,19 +31,11 @@ Text::Text(std::string str, unsigned int scrWidth, unsigned int scrHeight, unsig
 
 	NumChars = SetupText();
 
-	TextMaterial = loadTexture("textures/text.png");
-}
-
-// Text Destructor
-Text::~Text()
-{
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	TextMaterial = TextureHandle(loadTexture("textures/text.png"));
 }
 
 // Draws the Text to the screen.
-void Text::DrawText(Shader shader)
+void Text::DrawText(Shader& shader)
 {
 	shader.use();
 	shader.setInt("textMaterial", 0);
@@ -159,10 +152,14 @@ std::string::size_type Text::SetupText()
 		zipArr(indicesToAdd, 6, indices, i * 6);
 	}
 
-	// putting the stuff into the arrays/buffers
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
+	// putting the stuff into the arrays/buffers, which are made the first time and just
+	// refilled after that
+	if (VAO == 0)
+	{
+		VAO = VertexArrayHandle::Create();
+		VBO = BufferHandle::Create();
+		EBO = BufferHandle::Create();
+	}
 
 	glBindVertexArray(VAO);
 
@@ -17,14 +17,14 @@
 // our files
 #include "utils.h"
 #include "shader.h"
+#include "glhandles.h" // for VertexArrayHandle, BufferHandle, TextureHandle
 
 class Text
 {
   public:
 		Text(std::string, unsigned int, unsigned int, unsigned int = 30, unsigned int = 30, unsigned int = 400, unsigned int = 20, unsigned int = 5);
-		~Text();
 
-		void DrawText(Shader shader);
+		void DrawText(Shader& shader);
 		void SetText(std::string str);
 		void SetPosition(unsigned int, unsigned int);
 		void SetWidth(unsigned int);
@@ -33,13 +33,14 @@ class Text
 		void SetPadding(unsigned int);
 				
 	private:
-		unsigned int VAO, VBO, EBO;
+		VertexArrayHandle VAO;
+		BufferHandle VBO, EBO;
 		std::string Str;
 		std::string::size_type NumChars;
 		unsigned int ScrWidth, ScrHeight;
 		unsigned int XMin, YMin, MaxWidth;
 		unsigned int CharSize, Padding;
-		unsigned int TextMaterial;
+		TextureHandle TextMaterial;
 
 		std::string::size_type SetupText();
 		void makeLetter(float (&)[16], float, float, float, float, int);
@@ -10,57 +10,121 @@ using namespace std;
 #include <glm/glm.hpp> // gl maths
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp> // for mat4_cast
 
 // our files
 #include "thing.h" // for Thing declaration
 #include "model.h" // for Model class
 #include "shapes.h" // for Ellipsoid class
-#include "collision.h" // for collision utilities
-#include "camera.h" // for Camera class
+#include "physics.h" // for PhysicsWorld class
 #include "shader.h" // for Shader class
+#include "frustum.h" // for FrustumCuller class
+#include "renderqueue.h" // for RenderQueue class
 
 // Thing Class 
-Thing::Thing(glm::vec3 position, glm::vec3 velocity, glm::vec3 scale, glm::vec3 radii, string modelFilepath, string name) : Hitbox(radii, glm::vec3(0.0f), glm::vec3(0.0f)), ThingModel(modelFilepath.c_str()) {
-	Position = position;
-	Velocity = velocity;
+Thing::Thing(PhysicsWorld &world, glm::vec3 position, glm::vec3 velocity, glm::vec3 scale, glm::vec3 radii, Model &model, string name) : ThingModel(model), World(world) {
+	BodyID = World.AddBody(Ellipsoid(radii, position, velocity));
 	Scale = scale;
 
 	Name = name;
 }
 
-// Computes the movement of the Thing over a single frame
-void Thing::PassFrame(vector<Triangle>& tris) {
-	// Handling intersections with terrain
-	Hitbox.Position = Position;
-	Hitbox.Velocity = Velocity;
-	handleIntersection(Hitbox, tris);
-	Position = Hitbox.Position;
-	Velocity = Hitbox.Velocity;
-
-	// Adding gravity and friction after handling intersections
-	Velocity += glm::vec3(0.0f, -0.001f, 0.0f);
-	Velocity *= 0.99f;
+// Gets the Thing's body in the PhysicsWorld, which holds its position and velocity
+Ellipsoid& Thing::Body() {
+	return World.GetBody(BodyID);
+}
+const Ellipsoid& Thing::Body() const {
+	return World.GetBody(BodyID);
 }
 
-// Renders the Thing
-void Thing::RenderThing(Camera &camera, Shader &shader, int SCR_WIDTH, int SCR_HEIGHT) {
+// Gets the Thing's model matrix, from its body's position and orientation and its scale
+glm::mat4 Thing::ModelMatrix() const {
 	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, Position);
+	model = glm::translate(model, Body().Position);
+	model = model * glm::mat4_cast(Body().Orientation);
 	model = glm::scale(model, Scale);
+	return model;
+}
 
-	glm::mat4 view = camera.GetViewMatrix();
-
-	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-
+// Renders the Thing on its own
+void Thing::RenderThing(Shader &shader) {
+	// the view and projection come from the camera's uniform buffer
 	shader.use();
-	shader.setMat4("model", model);
-	shader.setMat4("view", view);
-	shader.setMat4("projection", projection);
+	shader.setMat4("model", ModelMatrix());
 
 	ThingModel.Draw(shader);
 }
 
 // Prints the thing
 void Thing::Print() const {
-	cout << "Thing " << Name << ": Position (" << Position.x << ", " << Position.y << ", " << Position.z << ")" << endl;
+	const glm::vec3 &position = Body().Position;
+	cout << "Thing " << Name << ": Position (" << position.x << ", " << position.y << ", " << position.z << ")" << endl;
+}
+
+// ThingRenderer Constructor
+ThingRenderer::ThingRenderer() : lastBatches(0), lastInstances(0) {
+}
+
+// Adds a Thing to be drawn this frame
+void ThingRenderer::Add(const Thing &thing) {
+	unsigned int batch = 0;
+	while (batch < models.size() && models[batch] != &thing.ThingModel)
+		++batch;
+
+	if (batch == models.size()) {
+		models.push_back(&thing.ThingModel);
+		transforms.push_back(vector<glm::mat4>());
+	}
+	transforms[batch].push_back(thing.ModelMatrix());
+}
+
+// Draws every Thing added since the last Draw that's in the culler's frustum (if there is
+// one), one instanced batch per model
+void ThingRenderer::Draw(Shader &shader, FrustumCuller *culler, RenderQueue *queue) {
+	lastBatches = 0;
+	lastInstances = 0;
+
+	if (!queue)
+		shader.use();
+	for (unsigned int i = 0; i < models.size(); ++i) {
+		if (culler) {
+			vector<glm::mat4> &batch = transforms[i];
+			culler->Clear();
+			for (unsigned int j = 0; j < batch.size(); ++j)
+				culler->Add(models[i]->GetBounds(), batch[j]);
+			culler->Cull();
+
+			// keeping just the visible ones, in order
+			unsigned int kept = 0;
+			for (unsigned int j = 0; j < batch.size(); ++j) {
+				if (culler->Visible(j))
+					batch[kept++] = batch[j];
+			}
+			batch.resize(kept);
+		}
+
+		if (transforms[i].empty())
+			continue;
+
+		// a batch is spread all over the place, so it's only sorted by state
+		if (queue) {
+			models[i]->UploadInstances(transforms[i]);
+			models[i]->AddInstanced(*queue, shader, transforms[i].size());
+		}
+		else
+			models[i]->DrawInstanced(shader, transforms[i]);
+		++lastBatches;
+		lastInstances += transforms[i].size();
+		transforms[i].clear();
+	}
+}
+
+// Gets how many models the last Draw drew
+unsigned int ThingRenderer::NumBatches() const {
+	return lastBatches;
+}
+
+// Gets how many Things the last Draw drew
+unsigned int ThingRenderer::NumInstances() const {
+	return lastInstances;
 }
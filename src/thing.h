@@ -13,26 +13,60 @@
 // our files
 #include "model.h" // for Model class
 #include "shapes.h" // for Ellipsoid and Triangle class 
-#include "camera.h" // for Camera class
 #include "shader.h" // for Shader class
+#include "physics.h" // for PhysicsWorld class
+#include "frustum.h" // for FrustumCuller class
+#include "renderqueue.h" // for RenderQueue class
+
+// things collide as ellipsoids, so their models don't need to keep any vertex data around
+const VertexResidency THING_RESIDENCY = RELEASE_VERTICES;
 
 // Thing class
+// The Thing's position, velocity and hitbox live in a PhysicsWorld as a body, so that the
+// world can step every body at once. Its model is loaded separately and can be shared by
+// lots of Things, which lets them be drawn together with a ThingRenderer.
 class Thing {
 	public:
-		glm::vec3 Position;
-		glm::vec3 Velocity;
 		glm::vec3 Scale;
 		std::string Name;
 
-		Ellipsoid Hitbox;
-		Model ThingModel;
+		unsigned int BodyID;
+		Model &ThingModel;
 		
-		Thing(glm::vec3, glm::vec3, glm::vec3, glm::vec3, std::string, std::string="");
+		Thing(PhysicsWorld&, glm::vec3, glm::vec3, glm::vec3, glm::vec3, Model&, std::string="");
+
+		Ellipsoid& Body();
+		const Ellipsoid& Body() const;
 
-		void PassFrame(std::vector<Triangle>&);
-		void RenderThing(Camera&, Shader&, int, int);
+		glm::mat4 ModelMatrix() const;
+		void RenderThing(Shader&);
 		
 		void Print() const;
+
+	private:
+		PhysicsWorld &World;
+};
+
+// ThingRenderer class
+// Gathers up Things each frame and draws all the ones sharing a model in one instanced
+// draw (per mesh), with the shader's INSTANCED variant. Given a culler, Things outside
+// the frustum are left out, and given a render queue, the draws go into it instead of
+// straight to gl.
+class ThingRenderer {
+	public:
+		ThingRenderer();
+
+		void Add(const Thing&);
+		void Draw(Shader&, FrustumCuller* = NULL, RenderQueue* = NULL);
+
+		unsigned int NumBatches() const;
+		unsigned int NumInstances() const;
+
+	private:
+		// the transforms of each model's Things, kept between frames so they don't reallocate
+		std::vector<Model*> models;
+		std::vector<std::vector<glm::mat4> > transforms;
+		unsigned int lastBatches, lastInstances;
 };
 
 #endif
@@ -0,0 +1,87 @@
+// uniformbuffers.cpp
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// stdlib
+#include <cstring> // for memcmp
+
+// our files
+#include "uniformbuffers.h" // for UniformBuffer declaration
+#include "light.h" // for LightsData
+
+// the structs have to match the std140 layout of the blocks in the shaders byte for byte
+static_assert(sizeof(CameraData) == 160, "CameraData doesn't match the Camera block");
+static_assert(sizeof(MaterialData) == 16, "MaterialData doesn't match the MaterialBlock block");
+static_assert(sizeof(PointLightData) == 64, "PointLightData doesn't match std140");
+static_assert(sizeof(DirectionalLightData) == 64, "DirectionalLightData doesn't match std140");
+static_assert(sizeof(SpotLightData) == 96, "SpotLightData doesn't match std140");
+
+// UniformBuffer Constructor. Makes the buffer, and binds it to the given binding point
+// for good.
+template <typename Data>
+UniformBuffer<Data>::UniformBuffer(unsigned int binding) {
+	data = Data();
+	dirty = true;
+
+	UBO = BufferHandle::Create();
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+}
+
+// Replaces the data. Only marks the buffer as needing an upload if it actually changed.
+// Returns whether it changed.
+template <typename Data>
+bool UniformBuffer<Data>::Set(const Data &newData) {
+	if (memcmp(&data, &newData, sizeof(Data)) == 0)
+		return false;
+	data = newData;
+	dirty = true;
+	return true;
+}
+
+// Gets the data to change in place, marking the buffer as needing an upload
+template <typename Data>
+Data& UniformBuffer<Data>::Edit() {
+	dirty = true;
+	return data;
+}
+
+// Gets the data as it is on the cpu
+template <typename Data>
+const Data& UniformBuffer<Data>::Get() const {
+	return data;
+}
+
+// Uploads the data if it's changed since the last upload. Returns whether it uploaded.
+template <typename Data>
+bool UniformBuffer<Data>::Upload() {
+	if (!dirty)
+		return false;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Data), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	dirty = false;
+	return true;
+}
+
+// Binds whichever of our blocks a shader program declares to their binding points
+void bindUniformBlocks(unsigned int program) {
+	const char *names[] = {CAMERA_BLOCK, LIGHTS_BLOCK, MATERIAL_BLOCK};
+	const unsigned int bindings[] = {CAMERA_BINDING, LIGHTS_BINDING, MATERIAL_BINDING};
+
+	for (unsigned int i = 0; i < 3; ++i) {
+		unsigned int index = glGetUniformBlockIndex(program, names[i]);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, bindings[i]);
+	}
+}
+
+// instantiating the buffers we'll need
+template class UniformBuffer<CameraData>;
+template class UniformBuffer<LightsData>;
+template class UniformBuffer<MaterialData>;
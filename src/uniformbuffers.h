@@ -0,0 +1,63 @@
+#ifndef UNIFORMBUFFERS_H
+#define UNIFORMBUFFERS_H
+// uniformbuffers.h
+// Defines the UniformBuffer class, which keeps a block of shader data (laid out std140) in
+// a uniform buffer object that every shader reads from.
+
+// libraries
+#include <glad/glad.h> // for opengl flags
+#include <glm/glm.hpp> // for gl maths
+
+// our files
+#include "glhandles.h" // for BufferHandle
+
+// binding points, which every shader's blocks get bound to by name when it's linked
+const unsigned int CAMERA_BINDING = 0;
+const unsigned int LIGHTS_BINDING = 1;
+const unsigned int MATERIAL_BINDING = 2;
+
+// the names each block is declared with in the shaders
+const char* const CAMERA_BLOCK = "Camera";
+const char* const LIGHTS_BLOCK = "Lights";
+const char* const MATERIAL_BLOCK = "MaterialBlock";
+
+// Per-frame camera data, matching the Camera block in the shaders
+struct CameraData {
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::vec3 ViewPos;
+	float Time;
+	glm::vec2 ScreenSize; // in pixels, for finding which light cluster a fragment is in
+	float NearPlane;
+	float FarPlane;
+};
+
+// Per-material data, matching the MaterialBlock block in the shaders. Emission is picked
+// by shader variant (DO_EMISSION) instead.
+struct MaterialData {
+	float Shininess;
+	float pad[3];
+};
+
+// UniformBuffer class
+// Holds a copy of the data on the cpu, and only uploads it when it's actually changed. Owns
+// its buffer through a handle, so it can be moved but not copied.
+template <typename Data>
+class UniformBuffer {
+	public:
+		UniformBuffer(unsigned int);
+
+		bool Set(const Data&);
+		Data& Edit();
+		const Data& Get() const;
+		bool Upload();
+
+	private:
+		BufferHandle UBO;
+		Data data;
+		bool dirty;
+};
+
+void bindUniformBlocks(unsigned int);
+
+#endif
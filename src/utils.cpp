@@ -14,6 +14,8 @@
 #include <iostream> // for cout
 #include <cstring> // for strlen
 #include <cmath> // for pow
+#include <vector> // for vector
+#include <algorithm> // for stable_sort, min, max
 
 // generates an image given a width, a height, and a pointer to the image to store it in
 void genImg(int width, int height, GLubyte *img) {
@@ -187,3 +189,62 @@ bool solveQuadrat(Num a, Num b, Num c, Num& r0, Num& r1)
 // instantiating the versions of solveQuadrat we'll need
 template bool solveQuadrat<float>(float, float, float, float&, float&);
 template bool solveQuadrat<double>(double, double, double, double&, double&);
+
+// spreads the lowest 21 bits of a number out so there are two zero bits between each one
+static unsigned long long spreadBits(unsigned long long x)
+{
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffff;
+	x = (x | x << 16) & 0x1f0000ff0000ff;
+	x = (x | x << 8) & 0x100f00f00f00f00f;
+	x = (x | x << 4) & 0x10c30c30c30c30c3;
+	x = (x | x << 2) & 0x1249249249249249;
+	return x;
+}
+
+// finds where a point falls along a Z-order (Morton) curve through a bounding box.
+// points close together in space tend to get codes close together.
+unsigned long long mortonCode(const glm::vec3 &point, const glm::vec3 &minCorner, const glm::vec3 &maxCorner)
+{
+	const float MAX_CELL = (float)0x1fffff;
+
+	unsigned long long cells[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		float extent = maxCorner[i] - minCorner[i];
+		float relative = (extent > 0.0f) ? (point[i] - minCorner[i]) / extent : 0.0f;
+		relative = std::min(std::max(relative, 0.0f), 1.0f);
+		cells[i] = (unsigned long long)(relative * MAX_CELL);
+	}
+
+	return spreadBits(cells[0]) | (spreadBits(cells[1]) << 1) | (spreadBits(cells[2]) << 2);
+}
+
+// finds the order to put points in so that they follow a Z-order curve.
+// element i of the result is the index of the point that should go in slot i. points with
+// the same code keep their original order.
+std::vector<unsigned int> mortonOrder(const std::vector<glm::vec3> &points)
+{
+	glm::vec3 minCorner(0.0f), maxCorner(0.0f);
+	if (!points.empty())
+	{
+		minCorner = points[0];
+		maxCorner = points[0];
+	}
+	for (unsigned int i = 1; i < points.size(); ++i)
+	{
+		minCorner = glm::min(minCorner, points[i]);
+		maxCorner = glm::max(maxCorner, points[i]);
+	}
+
+	std::vector<unsigned long long> codes(points.size());
+	std::vector<unsigned int> order(points.size());
+	for (unsigned int i = 0; i < points.size(); ++i)
+	{
+		codes[i] = mortonCode(points[i], minCorner, maxCorner);
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&codes](unsigned int a, unsigned int b) { return codes[a] < codes[b]; });
+	return order;
+}
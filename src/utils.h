@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
+#include <vector>
 
 void genImg(int, int, GLubyte*);
 unsigned int loadTexture(const char*, const std::string& = ".");
@@ -12,5 +13,7 @@ bool RayIntersectsTriangle(glm::vec3, glm::vec3, glm::vec3, glm::vec3, glm::vec3
 void LineIntersectsPlane(glm::vec3, glm::vec3, glm::vec3, glm::vec3, glm::vec3, float&, float&, float&);
 template <typename Num>
 bool solveQuadrat(Num, Num, Num, Num&, Num&);
+unsigned long long mortonCode(const glm::vec3&, const glm::vec3&, const glm::vec3&);
+std::vector<unsigned int> mortonOrder(const std::vector<glm::vec3>&);
 
 #endif